@@ -0,0 +1,62 @@
+/**
+ * Animation clock, see animation_clock.h.
+ */
+
+#include <pthread.h>
+
+#include "animation_clock.h"
+
+// Function to start a clock shared by the given number of renderers
+void animation_clock_init(AnimationClock *clock, int members, double now) {
+    pthread_mutex_init(&clock->lock, NULL);
+    clock->members = members;
+    clock->paused_members = 0;
+    clock->start_time = now;
+    clock->paused_since = now;
+    clock->paused_total = 0.0;
+}
+
+// Function to mark one member as paused. The clock stops once all are.
+void animation_clock_pause(AnimationClock *clock, double now) {
+    pthread_mutex_lock(&clock->lock);
+    if (++clock->paused_members == clock->members) {
+        clock->paused_since = now;
+    }
+    pthread_mutex_unlock(&clock->lock);
+}
+
+// Function to mark one member as running again
+void animation_clock_resume(AnimationClock *clock, double now) {
+    pthread_mutex_lock(&clock->lock);
+    if (clock->paused_members-- == clock->members) {
+        clock->paused_total += now - clock->paused_since;
+    }
+    pthread_mutex_unlock(&clock->lock);
+}
+
+// Function to drop a stretch of time (e.g. a stall) from the animation. Only
+// applied to unshared clocks, since a stall of one member must not move the
+// others out of step.
+void animation_clock_skip(AnimationClock *clock, double seconds) {
+    pthread_mutex_lock(&clock->lock);
+    if (clock->members == 1) {
+        clock->paused_total += seconds;
+    }
+    pthread_mutex_unlock(&clock->lock);
+}
+
+// Function to get the animation time at a CLOCK_MONOTONIC timestamp
+double animation_clock_time(AnimationClock *clock, double timestamp) {
+    pthread_mutex_lock(&clock->lock);
+    if (clock->paused_members == clock->members) {
+        timestamp = clock->paused_since;
+    }
+    double seconds = timestamp - clock->start_time - clock->paused_total;
+    pthread_mutex_unlock(&clock->lock);
+    return seconds;
+}
+
+// Function to release the clock
+void animation_clock_destroy(AnimationClock *clock) {
+    pthread_mutex_destroy(&clock->lock);
+}
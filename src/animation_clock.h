@@ -0,0 +1,30 @@
+/**
+ * Animation clock.
+ *
+ * Animation time is CLOCK_MONOTONIC time since the clock started, minus the
+ * time during which every member was paused. Renderers that share a clock
+ * (one per output of a screen) therefore stay in step.
+ */
+
+#ifndef ANIMATION_CLOCK_H
+#define ANIMATION_CLOCK_H
+
+#include <pthread.h>
+
+typedef struct {
+    pthread_mutex_t lock;
+    int members;
+    int paused_members;
+    double start_time;
+    double paused_since;
+    double paused_total;
+} AnimationClock;
+
+void animation_clock_init(AnimationClock *clock, int members, double now);
+void animation_clock_pause(AnimationClock *clock, double now);
+void animation_clock_resume(AnimationClock *clock, double now);
+void animation_clock_skip(AnimationClock *clock, double seconds);
+double animation_clock_time(AnimationClock *clock, double timestamp);
+void animation_clock_destroy(AnimationClock *clock);
+
+#endif
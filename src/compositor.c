@@ -0,0 +1,69 @@
+/**
+ * Compositing manager detection and bypass hints, see compositor.h.
+ */
+
+#include <stdio.h>
+
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+#include <X11/extensions/Xfixes.h>
+
+#include "compositor.h"
+
+// Function to look up the compositor selection and subscribe to owner changes
+int compositor_init(CompositorMonitor *monitor, Display *display, int screen) {
+    char name[32];
+    snprintf(name, sizeof(name), "_NET_WM_CM_S%d", screen);
+    monitor->selection = XInternAtom(display, name, False);
+    monitor->active = XGetSelectionOwner(display, monitor->selection) != None;
+
+    int error_base;
+    monitor->has_xfixes = XFixesQueryExtension(display, &monitor->xfixes_event_base, &error_base);
+    if (monitor->has_xfixes) {
+        XFixesSelectSelectionInput(display, RootWindow(display, screen), monitor->selection,
+                                   XFixesSetSelectionOwnerNotifyMask |
+                                   XFixesSelectionWindowDestroyNotifyMask |
+                                   XFixesSelectionClientCloseNotifyMask);
+    }
+    return 0;
+}
+
+// Function to re-read the selection owner, for renderers that do not see the
+// XFixes events themselves. Returns 1 if the state changed.
+int compositor_refresh(CompositorMonitor *monitor, Display *display) {
+    int active = XGetSelectionOwner(display, monitor->selection) != None;
+    if (active == monitor->active) {
+        return 0;
+    }
+    monitor->active = active;
+    return 1;
+}
+
+// Function to update state from an X event. Returns 1 if the compositor
+// started or stopped.
+int compositor_handle_event(CompositorMonitor *monitor, Display *display, const XEvent *event) {
+    (void)display;
+    if (!monitor->has_xfixes || event->type != monitor->xfixes_event_base + XFixesSelectionNotify) {
+        return 0;
+    }
+    const XFixesSelectionNotifyEvent *notify = (const XFixesSelectionNotifyEvent *)event;
+    if (notify->selection != monitor->selection) {
+        return 0;
+    }
+    int active = notify->subtype == XFixesSetSelectionOwnerNotify && notify->owner != None;
+    if (active == monitor->active) {
+        return 0;
+    }
+    monitor->active = active;
+    return 1;
+}
+
+// Function to set the _NET_WM_BYPASS_COMPOSITOR hint on a window
+void compositor_set_bypass(Display *display, Window window, int mode) {
+    if (mode == BYPASS_UNSET) {
+        return;
+    }
+    Atom bypass = XInternAtom(display, "_NET_WM_BYPASS_COMPOSITOR", False);
+    unsigned long value = mode;
+    XChangeProperty(display, window, bypass, XA_CARDINAL, 32, PropModeReplace, (unsigned char *)&value, 1);
+}
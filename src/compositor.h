@@ -0,0 +1,32 @@
+/**
+ * Compositing manager detection and bypass hints.
+ *
+ * A compositor owns the `_NET_WM_CM_S<screen>` selection (EWMH). Ownership
+ * changes are followed through XFixes selection events when available.
+ */
+
+#ifndef COMPOSITOR_H
+#define COMPOSITOR_H
+
+#include <X11/Xlib.h>
+
+// Values of _NET_WM_BYPASS_COMPOSITOR; BYPASS_UNSET leaves the property alone
+enum {
+    BYPASS_UNSET = 0,
+    BYPASS_REQUEST = 1,  // Ask the compositor to unredirect the window
+    BYPASS_DISABLE = 2,  // Ask the compositor to keep compositing it
+};
+
+typedef struct {
+    Atom selection;
+    int has_xfixes;
+    int xfixes_event_base;
+    int active;
+} CompositorMonitor;
+
+int compositor_init(CompositorMonitor *monitor, Display *display, int screen);
+int compositor_refresh(CompositorMonitor *monitor, Display *display);
+int compositor_handle_event(CompositorMonitor *monitor, Display *display, const XEvent *event);
+void compositor_set_bypass(Display *display, Window window, int mode);
+
+#endif
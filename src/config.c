@@ -0,0 +1,313 @@
+/**
+ * Runtime configuration file, see config.h.
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/inotify.h>
+
+// Color Palette
+#include "nord.h"
+
+#include "config.h"
+
+// Named palette colors accepted as values
+static const float nord_palette[16][4] = {
+    {NORD0}, {NORD1}, {NORD2}, {NORD3}, {NORD4}, {NORD5}, {NORD6}, {NORD7},
+    {NORD8}, {NORD9}, {NORD10}, {NORD11}, {NORD12}, {NORD13}, {NORD14}, {NORD15},
+};
+
+// Function to fill in the compiled-in defaults
+void config_defaults(Config *config) {
+    static const float default_colors[CONFIG_COLORS][4] = {
+        {NORD9},   // Light blue
+        {NORD10},  // Darker blue
+        {NORD11},  // Red
+        {NORD12},  // Orange
+    };
+    static const float default_background[4] = {NORD0};
+
+    config->target_fps = 60;
+    config->samples = 4;
+    config->rotation_speed = 30.0f;  // 0.5 degrees per frame at 60 FPS
+    memcpy(config->background, default_background, sizeof(config->background));
+    memcpy(config->colors, default_colors, sizeof(config->colors));
+    config->camera[0] = 0.0f;
+    config->camera[1] = 0.0f;
+    config->camera[2] = 5.0f;
+}
+
+// Function to get the config file path. Returns -1 if there is no home.
+int config_path(char *path, size_t size) {
+    const char *config_home = getenv("XDG_CONFIG_HOME");
+    int length;
+    if (config_home && config_home[0] == '/') {
+        length = snprintf(path, size, "%s/desktop_cube/config", config_home);
+    } else {
+        const char *home = getenv("HOME");
+        if (!home || !home[0]) {
+            return -1;
+        }
+        length = snprintf(path, size, "%s/.config/desktop_cube/config", home);
+    }
+    return length > 0 && (size_t)length < size ? 0 : -1;
+}
+
+// Function to parse a whole-string integer
+static int parse_int(const char *text, int *value) {
+    char *end;
+    errno = 0;
+    long result = strtol(text, &end, 10);
+    if (errno || end == text || *end || result < INT_MIN || result > INT_MAX) {
+        return -1;
+    }
+    *value = (int)result;
+    return 0;
+}
+
+// Function to parse whitespace-separated floats, exactly `count` of them
+static int parse_floats(const char *text, float *values, int count) {
+    for (int i = 0; i < count; i++) {
+        char *end;
+        errno = 0;
+        double value = strtod(text, &end);
+        if (errno || end == text || !isfinite(value)) {
+            return -1;
+        }
+        values[i] = value;
+        text = end;
+    }
+    while (isspace((unsigned char)*text)) text++;
+    return *text ? -1 : 0;
+}
+
+// Function to parse a color given as a palette name or #rrggbb. Advances
+// `text` past the color.
+static int parse_color(const char **text, float *color) {
+    const char *start = *text;
+    while (isspace((unsigned char)*start)) start++;
+    const char *end = start;
+    while (*end && !isspace((unsigned char)*end)) end++;
+    size_t length = end - start;
+
+    unsigned int red, green, blue;
+    int index, consumed;
+    if (length == 7 && sscanf(start, "#%2x%2x%2x%n", &red, &green, &blue, &consumed) == 3 &&
+        consumed == 7) {
+        color[0] = red / 255.0f;
+        color[1] = green / 255.0f;
+        color[2] = blue / 255.0f;
+        color[3] = 1.0f;
+    } else if (length > 4 && length < 7 && strncmp(start, "nord", 4) == 0 &&
+               sscanf(start + 4, "%d%n", &index, &consumed) == 1 && (size_t)consumed == length - 4 &&
+               index >= 0 && index < 16) {
+        memcpy(color, nord_palette[index], sizeof(nord_palette[index]));
+    } else {
+        return -1;
+    }
+    *text = end;
+    return 0;
+}
+
+// Function to parse `count` colors and nothing else
+static int parse_colors(const char *text, float (*colors)[4], int count) {
+    for (int i = 0; i < count; i++) {
+        if (parse_color(&text, colors[i]) != 0) {
+            return -1;
+        }
+    }
+    while (isspace((unsigned char)*text)) text++;
+    return *text ? -1 : 0;
+}
+
+// Function to find the start of a comment. '#' also starts #rrggbb colors,
+// which are not comments.
+static char *find_comment(char *line) {
+    for (char *hash = strchr(line, '#'); hash; hash = strchr(hash + 1, '#')) {
+        int digits = 0;
+        while (digits < 7 && isxdigit((unsigned char)hash[1 + digits])) digits++;
+        if (digits != 6 || (hash[7] && !isspace((unsigned char)hash[7]))) {
+            return hash;
+        }
+    }
+    return NULL;
+}
+
+// Function to strip leading and trailing whitespace in place
+static char *trim(char *text) {
+    while (isspace((unsigned char)*text)) text++;
+    char *end = text + strlen(text);
+    while (end > text && isspace((unsigned char)end[-1])) end--;
+    *end = '\0';
+    return text;
+}
+
+// Function to apply one `key = value` setting. Returns -1 if the key is
+// unknown or the value is out of range.
+static int parse_setting(Config *config, const char *key, const char *value) {
+    if (strcmp(key, "target_fps") == 0) {
+        int fps;
+        if (parse_int(value, &fps) != 0 || fps < 1 || fps > 240) {
+            return -1;
+        }
+        config->target_fps = fps;
+    } else if (strcmp(key, "samples") == 0) {
+        int samples;
+        if (parse_int(value, &samples) != 0 || samples < 0 || samples > 16 ||
+            (samples & (samples - 1)) != 0 || samples == 1) {
+            return -1;
+        }
+        config->samples = samples;
+    } else if (strcmp(key, "rotation_speed") == 0) {
+        float speed;
+        if (parse_floats(value, &speed, 1) != 0 || fabsf(speed) > 720.0f) {
+            return -1;
+        }
+        config->rotation_speed = speed;
+    } else if (strcmp(key, "background") == 0) {
+        float background[1][4];
+        if (parse_colors(value, background, 1) != 0) {
+            return -1;
+        }
+        memcpy(config->background, background[0], sizeof(config->background));
+    } else if (strcmp(key, "colors") == 0) {
+        float colors[CONFIG_COLORS][4];
+        if (parse_colors(value, colors, CONFIG_COLORS) != 0) {
+            return -1;
+        }
+        memcpy(config->colors, colors, sizeof(config->colors));
+    } else if (strcmp(key, "camera") == 0) {
+        // The camera looks at the origin with +Y up, so it must not sit on
+        // the Y axis
+        float camera[3];
+        if (parse_floats(value, camera, 3) != 0 || (camera[0] == 0.0f && camera[2] == 0.0f)) {
+            return -1;
+        }
+        memcpy(config->camera, camera, sizeof(config->camera));
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+// Function to load the config file on top of the defaults. A missing file
+// yields the defaults. Returns -1, leaving `config` untouched, if the file
+// cannot be read or has any invalid line.
+int config_load(Config *config, const char *path) {
+    Config parsed;
+    config_defaults(&parsed);
+
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        if (errno == ENOENT) {
+            *config = parsed;
+            return 0;
+        }
+        perror(path);
+        return -1;
+    }
+
+    char line[256];
+    int line_number = 0;
+    int status = 0;
+    while (status == 0 && fgets(line, sizeof(line), file)) {
+        line_number++;
+
+        // A line that does not fit is an error, not two lines
+        if (!strchr(line, '\n') && !feof(file)) {
+            fprintf(stderr, "%s:%d: line too long, keeping the current configuration\n", path, line_number);
+            status = -1;
+            break;
+        }
+        char *comment = find_comment(line);
+        if (comment) {
+            *comment = '\0';
+        }
+        char *setting = trim(line);
+        if (!*setting) {
+            continue;
+        }
+        char *equals = strchr(setting, '=');
+        if (!equals) {
+            status = -1;
+        } else {
+            *equals = '\0';
+            status = parse_setting(&parsed, trim(setting), trim(equals + 1));
+        }
+        if (status != 0) {
+            fprintf(stderr, "%s:%d: invalid setting, keeping the current configuration\n", path, line_number);
+        }
+    }
+    fclose(file);
+
+    if (status == 0) {
+        *config = parsed;
+    }
+    return status;
+}
+
+// Function to expand the configured colors to `count` vertices, cycling
+// through them
+void config_vertex_colors(const Config *config, float (*colors)[4], int count) {
+    for (int i = 0; i < count; i++) {
+        memcpy(colors[i], config->colors[i % CONFIG_COLORS], sizeof(colors[i]));
+    }
+}
+
+// Function to start watching the config file. Returns a pollable fd, or -1
+// if the config directory cannot be watched (e.g. it does not exist).
+int config_watch_open(ConfigWatch *watch, const char *path) {
+    watch->fd = -1;
+    watch->watch = -1;
+    const char *slash = strrchr(path, '/');
+    if (!slash) {
+        return -1;
+    }
+    watch->name = slash + 1;
+
+    char directory[4096];
+    snprintf(directory, sizeof(directory), "%.*s", (int)(slash - path), path);
+    watch->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watch->fd < 0) {
+        perror("inotify_init1");
+        return -1;
+    }
+    watch->watch = inotify_add_watch(watch->fd, directory, IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE);
+    if (watch->watch < 0) {
+        close(watch->fd);
+        watch->fd = -1;
+        return -1;
+    }
+    return watch->fd;
+}
+
+// Function to drain inotify events. Returns 1 if the config file was
+// written, replaced or removed.
+int config_watch_dispatch(ConfigWatch *watch) {
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    int changed = 0;
+    ssize_t length;
+    while ((length = read(watch->fd, buffer, sizeof(buffer))) > 0) {
+        for (char *p = buffer; p < buffer + length;) {
+            const struct inotify_event *event = (const struct inotify_event *)p;
+            if (event->len && strcmp(event->name, watch->name) == 0) {
+                changed = 1;
+            }
+            p += sizeof(*event) + event->len;
+        }
+    }
+    return changed;
+}
+
+// Function to stop watching the config file
+void config_watch_close(ConfigWatch *watch) {
+    if (watch->fd >= 0) close(watch->fd);
+    watch->fd = -1;
+}
@@ -0,0 +1,52 @@
+/**
+ * Runtime configuration file.
+ *
+ * Read from $XDG_CONFIG_HOME/desktop_cube/config (~/.config/desktop_cube/config
+ * without XDG_CONFIG_HOME) at startup and reloaded whenever it changes. One
+ * `key = value` per line, `#` starts a comment:
+ *
+ *     target_fps = 30
+ *     samples = 0                          # multisampling, 0 disables it
+ *     rotation_speed = 45                  # degrees per second
+ *     background = nord0                   # nord0..nord15 or #rrggbb
+ *     colors = nord9 nord10 nord11 #d08770 # cube corners
+ *     camera = 0 0 5                       # eye position
+ *
+ * A file with any invalid line is rejected as a whole, keeping the previous
+ * configuration. Unset keys keep their defaults.
+ */
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <stddef.h>
+
+#define CONFIG_COLORS 4
+
+typedef struct {
+    int target_fps;
+    int samples;
+    float rotation_speed;
+    float background[4];
+    float colors[CONFIG_COLORS][4];
+    float camera[3];
+} Config;
+
+// Watches the directory of the config file, so that editors that replace the
+// file instead of writing it in place are noticed too
+typedef struct {
+    int fd;
+    int watch;
+    const char *name;
+} ConfigWatch;
+
+void config_defaults(Config *config);
+int config_path(char *path, size_t size);
+int config_load(Config *config, const char *path);
+void config_vertex_colors(const Config *config, float (*colors)[4], int count);
+
+int config_watch_open(ConfigWatch *watch, const char *path);
+int config_watch_dispatch(ConfigWatch *watch);
+void config_watch_close(ConfigWatch *watch);
+
+#endif
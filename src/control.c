@@ -0,0 +1,178 @@
+/**
+ * Local control socket, see control.h.
+ */
+
+#define _GNU_SOURCE  // accept4()
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "control.h"
+
+// Function to build a path in the per-user runtime directory. Returns -1 if
+// it does not fit.
+int control_runtime_path(char *path, size_t size, const char *name) {
+    const char *runtime_dir = getenv("XDG_RUNTIME_DIR");
+    int length;
+    if (runtime_dir && runtime_dir[0] == '/') {
+        length = snprintf(path, size, "%s/%s", runtime_dir, name);
+    } else {
+        length = snprintf(path, size, "/tmp/%s-%u", name, (unsigned int)getuid());
+    }
+    return length > 0 && (size_t)length < size ? 0 : -1;
+}
+
+// Function to get the control socket path
+int control_socket_path(char *path, size_t size) {
+    struct sockaddr_un address;
+    if (size > sizeof(address.sun_path)) {
+        size = sizeof(address.sun_path);
+    }
+    return control_runtime_path(path, size, "desktop_cube.sock");
+}
+
+// Function to fill in a socket address. Returns -1 if the path is too long.
+static int socket_address(struct sockaddr_un *address, const char *path) {
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address->sun_path)) {
+        return -1;
+    }
+    strcpy(address->sun_path, path);
+    return 0;
+}
+
+// Function to create the listening socket. A stale socket from a previous
+// run is replaced, but not one another instance still listens on.
+int control_listen(const char *path) {
+    struct sockaddr_un address;
+    if (socket_address(&address, path) != 0) {
+        fprintf(stderr, "Control socket path too long: %s\n", path);
+        return -1;
+    }
+
+    int probe = control_connect(path);
+    if (probe >= 0) {
+        close(probe);
+        fprintf(stderr, "Control socket %s is in use by another instance\n", path);
+        return -1;
+    }
+    unlink(path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+
+    // Only the owner may connect
+    mode_t mask = umask(0077);
+    int status = bind(fd, (struct sockaddr *)&address, sizeof(address));
+    umask(mask);
+    if (status != 0 || listen(fd, 4) != 0) {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Function to accept a pending connection. Returns NULL if there is none.
+ControlClient *control_accept(int listen_fd) {
+    int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+    ControlClient *client = calloc(1, sizeof(*client));
+    if (!client) {
+        close(fd);
+        return NULL;
+    }
+    client->fd = fd;
+    return client;
+}
+
+// Function to take the next complete line from the client, without the
+// newline. Returns 1 if a line was stored, 0 if more input is needed and -1
+// if the client disconnected or sent an overlong line.
+int control_read_line(ControlClient *client, char *line, size_t size) {
+    for (;;) {
+        char *newline = memchr(client->buffer, '\n', client->length);
+        if (newline) {
+            size_t length = newline - client->buffer;
+            if (length >= size) {
+                return -1;
+            }
+            memcpy(line, client->buffer, length);
+            line[length] = '\0';
+            if (length > 0 && line[length - 1] == '\r') {
+                line[length - 1] = '\0';
+            }
+            client->length -= length + 1;
+            memmove(client->buffer, newline + 1, client->length);
+            return 1;
+        }
+        if (client->length == sizeof(client->buffer)) {
+            return -1;
+        }
+
+        ssize_t count = read(client->fd, client->buffer + client->length,
+                             sizeof(client->buffer) - client->length);
+        if (count > 0) {
+            client->length += count;
+        } else if (count < 0 && (errno == EAGAIN || errno == EINTR)) {
+            return 0;
+        } else {
+            return -1;
+        }
+    }
+}
+
+// Function to send a reply line. Replies are short, so a client that does not
+// read them just loses them instead of blocking the main loop.
+void control_reply(ControlClient *client, const char *format, ...) {
+    char reply[CONTROL_REPLY_MAX];
+    va_list arguments;
+    va_start(arguments, format);
+    int length = vsnprintf(reply, sizeof(reply) - 1, format, arguments);
+    va_end(arguments);
+    if (length < 0) {
+        return;
+    }
+    if ((size_t)length > sizeof(reply) - 2) {
+        length = sizeof(reply) - 2;
+    }
+    reply[length++] = '\n';
+    send(client->fd, reply, length, MSG_NOSIGNAL | MSG_DONTWAIT);
+}
+
+// Function to disconnect and free a client
+void control_close(ControlClient *client) {
+    close(client->fd);
+    free(client);
+}
+
+// Function to connect to a running instance. Returns the socket, or -1.
+int control_connect(const char *path) {
+    struct sockaddr_un address;
+    if (socket_address(&address, path) != 0) {
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
@@ -0,0 +1,36 @@
+/**
+ * Local control socket.
+ *
+ * A Unix stream socket at $XDG_RUNTIME_DIR/desktop_cube.sock (in /tmp,
+ * suffixed with the user id, without XDG_RUNTIME_DIR) accepting one command
+ * per line. Every command gets a one-line reply, "ok" (followed by the
+ * result for commands that return one) or "error <reason>".
+ * This module only handles the transport; the commands are interpreted by
+ * the application. It depends on libc alone, so desktop_cube-ctl shares it.
+ */
+
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include <stddef.h>
+
+#define CONTROL_LINE_MAX 256
+#define CONTROL_REPLY_MAX 4096
+
+typedef struct {
+    int fd;
+    size_t length;
+    char buffer[CONTROL_LINE_MAX];
+} ControlClient;
+
+int control_runtime_path(char *path, size_t size, const char *name);
+int control_socket_path(char *path, size_t size);
+int control_listen(const char *path);
+ControlClient *control_accept(int listen_fd);
+int control_read_line(ControlClient *client, char *line, size_t size);
+void control_reply(ControlClient *client, const char *format, ...)
+    __attribute__((format(printf, 2, 3)));
+void control_close(ControlClient *client);
+int control_connect(const char *path);
+
+#endif
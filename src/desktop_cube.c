@@ -19,312 +19,756 @@
  *     - GLEW
  */
 
+#include <errno.h>
+#include <getopt.h>
+#include <limits.h>
 #include <math.h>
 #include <signal.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <time.h>
+#include <string.h>
 #include <unistd.h>
 
-#include <GL/glew.h>
-#include <GL/glx.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
 
-#include <X11/Xatom.h>
 #include <X11/Xlib.h>
-#include <X11/Xutil.h>
-#include <X11/extensions/Xinerama.h>
-
-// Color Palette
-#include "nord.h"
-
-#define APP_TITLE "OPENGL DESKTOP"
-
-// Flag to control program termination
-volatile sig_atomic_t terminate = 0;
-
-// FPS and frame duration constants
-const int TARGET_FPS = 60;
-const int TARGET_FRAME_DURATION = 1000000 / TARGET_FPS;
-
-// GLX attributes for OpenGL context creation
-int glx_attributes[] = {
-    GLX_RGBA,               // Use RGBA color mode
-    GLX_DOUBLEBUFFER,       // Enable double buffering
-    GLX_RED_SIZE, 8,        // 8 bits for the red channel
-    GLX_GREEN_SIZE, 8,      // 8 bits for the green channel
-    GLX_BLUE_SIZE, 8,       // 8 bits for the blue channel
-    GLX_DEPTH_SIZE, 24,     // 24 bits for the depth buffer
-    GLX_SAMPLE_BUFFERS, 1,  // Enable multisampling
-    GLX_SAMPLES, 4,         // 4x antialiasing
-    None                    // Terminate the attribute list
-};
-
-
-// 3D cube vertices and indices
-GLfloat vertices[] = {
-    -1.0, -1.0, 1.0,   // 0 Bottom Left Front
-    1.0,  -1.0, 1.0,   // 1 Bottom Right Front
-    1.0,  -1.0, -1.0,  // 2 Bottom Right Back
-    -1.0, -1.0, -1.0,  // 3 Bottom Left Back
-    -1.0, 1.0,  1.0,   // 4 Top Left Front
-    1.0,  1.0,  1.0,   // 5 Top Right Front
-    1.0,  1.0,  -1.0,  // 6 Top Right Back
-    -1.0, 1.0,  -1.0   // 7 Top Left Back
-};
 
-GLubyte indices[] = {
-    0, 1, 2, 3,  // Bottom
-    4, 5, 6, 7,  // Top
-    0, 4, 7, 3,  // Left
-    1, 5, 6, 2,  // Right
-    0, 1, 5, 4,  // Back
-    3, 7, 6, 2   // Front
-};
-
-// Colors for cube vertices
-GLfloat colors[] = {
-    NORD9,   // Light blue
-    NORD10,  // Darker blue
-    NORD11,  // Red
-    NORD12,  // Orange
-    NORD9,   // Light blue
-    NORD10,  // Darker blue
-    NORD11,  // Red
-    NORD12,  // Orange
+#include "config.h"
+#include "control.h"
+#include "energy.h"
+#include "event_loop.h"
+#include "renderer.h"
+#include "sleep_monitor.h"
+
+#define MAX_CONTROL_CLIENTS 8
+
+// Quality tiers selectable through the control socket, as sample counts
+static const struct {
+    const char *name;
+    int samples;
+} quality_tiers[] = {
+    {"low", 0},
+    {"medium", 2},
+    {"high", 4},
 };
 
 // Struct to hold app context and data
 typedef struct {
+    Options options;
+
+    // Configuration file, reloaded when it changes
+    char config_path[4096];
+    Config config;
+    ConfigWatch config_watch;
+
+    // Control socket, its clients, and the settings it overrides (-1 when
+    // the config file value applies)
+    char control_path[108];
+    int control_fd;
+    ControlClient *clients[MAX_CONTROL_CLIENTS];
+    int fps_override;
+    int samples_override;
+
+    // One renderer (thread, X connection, window, context) per X screen, or
+    // per monitor with --thread-per-output
+    Renderer *renderers;
+    int num_renderers;
+    int live_renderers;
+
+    // Energy counters for the benchmark report, if readable
+    EnergyMeter energy;
+    int measure_energy;
+
+    // With --thread-per-output, one group per X screen sharing this
+    // connection
     Display *display;
-    Window window;
-    XineramaScreenInfo *screen_info;
-    XVisualInfo *visual_info;
-    GLXContext glx_context;
-    Colormap color_map;
-    GLuint vertex_buffer;
-    GLuint index_buffer;
-    GLuint color_buffer;
-    int num_screens;
+    OutputGroup *groups;
+    int num_groups;
+
+    // Main thread event loop: signals, sleep notifications, renderer exits
+    EventLoop loop;
+    int signal_fd;
+    int exit_fd;
+    SleepMonitor sleep_monitor;
+    int running;
 } AppData;
 
-// Function to handle signal termination
-void signal_handler(int signum) {
-    if (signum == SIGINT || signum == SIGTERM) {
-        terminate = 1;
+// Function to post a request to every renderer
+void post_all(AppData *app_data, int request) {
+    for (int i = 0; i < app_data->num_renderers; i++) {
+        renderer_post(&app_data->renderers[i], request);
+    }
+}
+
+// Function to handle signals delivered through the signalfd
+void on_signal(int fd, uint32_t events, void *user_data) {
+    AppData *app_data = user_data;
+    struct signalfd_siginfo info;
+    while (read(fd, &info, sizeof(info)) == sizeof(info)) {
+        switch (info.ssi_signo) {
+        case SIGINT:
+        case SIGTERM:
+        case SIGHUP:
+            app_data->running = 0;
+            break;
+        case SIGUSR1:
+            post_all(app_data, REQUEST_DUMP_STATS);
+            break;
+        }
+    }
+}
+
+// Function to handle logind sleep and lock notifications. Rendering stops
+// before the system goes to sleep and restarts with fresh deadlines on
+// resume; it also stops while the session is locked, since the locker
+// covers the desktop.
+void on_sleep_monitor(int fd, uint32_t events, void *user_data) {
+    AppData *app_data = user_data;
+    if (sleep_monitor_dispatch(&app_data->sleep_monitor)) {
+        post_all(app_data, (app_data->sleep_monitor.sleeping ? REQUEST_SLEEP : REQUEST_WAKE) |
+                           (app_data->sleep_monitor.locked ? REQUEST_LOCK : REQUEST_UNLOCK));
+    }
+}
+
+// Function to get the config file settings with the control socket
+// overrides applied
+Config effective_config(AppData *app_data) {
+    Config config = app_data->config;
+    if (app_data->fps_override > 0) {
+        config.target_fps = app_data->fps_override;
+    }
+    if (app_data->samples_override >= 0) {
+        config.samples = app_data->samples_override;
+    }
+    return config;
+}
+
+// Function to hand the current configuration to every renderer
+void publish_config(AppData *app_data) {
+    Config config = effective_config(app_data);
+    for (int i = 0; i < app_data->num_renderers; i++) {
+        renderer_set_config(&app_data->renderers[i], &config);
+    }
+}
+
+// Function to reload the config file when it changes. An invalid file is
+// reported and ignored, so the renderers keep the current configuration.
+void on_config_changed(int fd, uint32_t events, void *user_data) {
+    AppData *app_data = user_data;
+    if (!config_watch_dispatch(&app_data->config_watch) ||
+        config_load(&app_data->config, app_data->config_path) != 0) {
+        return;
+    }
+    fprintf(stderr, "Reloaded %s\n", app_data->config_path);
+    publish_config(app_data);
+}
+
+// Function to parse a whole string as a finite number. Returns -1 if
+// anything else is left over or it does not fit a double.
+int parse_number(const char *text, double *value) {
+    char *end;
+    errno = 0;
+    *value = strtod(text, &end);
+    return errno || end == text || *end || !isfinite(*value) ? -1 : 0;
+}
+
+// Function to parse a whole string as an integer in the given range.
+// Returns -1 if it is not one.
+int parse_integer(const char *text, int minimum, int maximum, int *value) {
+    char *end;
+    errno = 0;
+    long number = strtol(text, &end, 10);
+    if (errno || end == text || *end || number < minimum || number > maximum) {
+        return -1;
+    }
+    *value = (int)number;
+    return 0;
+}
+
+// Function to carry out one control command. Renderers apply the resulting
+// requests between frames, so a command never takes effect mid-frame.
+void handle_command(AppData *app_data, ControlClient *client, char *line) {
+    char *save;
+    char *command = strtok_r(line, " \t", &save);
+    char *argument = strtok_r(NULL, " \t", &save);
+    if (!command) {
+        control_reply(client, "error empty command");
+        return;
+    }
+    if (strtok_r(NULL, " \t", &save)) {
+        control_reply(client, "error too many arguments");
+        return;
+    }
+
+    if (strcmp(command, "pause") == 0 && !argument) {
+        post_all(app_data, REQUEST_PAUSE);
+    } else if (strcmp(command, "resume") == 0 && !argument) {
+        post_all(app_data, REQUEST_RESUME);
+    } else if (strcmp(command, "stats") == 0 && !argument) {
+        // Full statistics go to the log, a summary per renderer to the client
+        post_all(app_data, REQUEST_DUMP_STATS);
+        char reply[CONTROL_REPLY_MAX];
+        size_t length = snprintf(reply, sizeof(reply), "ok");
+        for (int i = 0; i < app_data->num_renderers && length < sizeof(reply); i++) {
+            Renderer *renderer = &app_data->renderers[i];
+            RendererSummary summary;
+            renderer_summary(renderer, &summary);
+            length += snprintf(reply + length, sizeof(reply) - length, "%s screen %d", i ? ";" : "",
+                               renderer->screen);
+            if (renderer->group && length < sizeof(reply)) {
+                length += snprintf(reply + length, sizeof(reply) - length, " output %d", renderer->output);
+            }
+            if (length < sizeof(reply)) {
+                length += snprintf(reply + length, sizeof(reply) - length,
+                                   ": %lu frames, %lu missed, %lu pauses, %s, frame p50 %.3f p99 %.3f ms",
+                                   summary.frames, summary.missed, summary.pauses,
+                                   summary.paused ? "paused" : "running", summary.frame_p50, summary.frame_p99);
+            }
+        }
+        control_reply(client, "%s", reply);
+        return;
+    } else if (strcmp(command, "fps") == 0 && argument) {
+        int fps = -1;
+        if (strcmp(argument, "default") != 0 && parse_integer(argument, 1, 240, &fps) != 0) {
+            control_reply(client, "error fps must be 1-240 or default");
+            return;
+        }
+        app_data->fps_override = fps;
+        publish_config(app_data);
+    } else if (strcmp(command, "quality") == 0 && argument) {
+        int samples = -2;
+        if (strcmp(argument, "default") == 0) {
+            samples = -1;
+        }
+        for (size_t i = 0; i < sizeof(quality_tiers) / sizeof(quality_tiers[0]); i++) {
+            if (strcmp(argument, quality_tiers[i].name) == 0) {
+                samples = quality_tiers[i].samples;
+            }
+        }
+        if (samples < -1) {
+            control_reply(client, "error quality must be low, medium, high or default");
+            return;
+        }
+        app_data->samples_override = samples;
+        publish_config(app_data);
+    } else if (strcmp(command, "trace") == 0) {
+        double seconds = 5.0;
+        if ((argument && parse_number(argument, &seconds) != 0) || !(seconds > 0 && seconds <= 600)) {
+            control_reply(client, "error trace duration must be 0-600 seconds");
+            return;
+        }
+        for (int i = 0; i < app_data->num_renderers; i++) {
+            renderer_trace(&app_data->renderers[i], (int)(seconds * 1000));
+        }
+    } else {
+        control_reply(client, "error unknown command or arguments: %s", command);
+        return;
+    }
+    control_reply(client, "ok");
+}
+
+// Function to drop a control client
+void close_client(AppData *app_data, int index) {
+    event_loop_remove(&app_data->loop, app_data->clients[index]->fd);
+    control_close(app_data->clients[index]);
+    app_data->clients[index] = NULL;
+}
+
+// Function to handle input from a control client
+void on_control_client(int fd, uint32_t events, void *user_data) {
+    AppData *app_data = user_data;
+    int index = 0;
+    while (index < MAX_CONTROL_CLIENTS && !(app_data->clients[index] && app_data->clients[index]->fd == fd)) {
+        index++;
+    }
+    if (index == MAX_CONTROL_CLIENTS) {
+        return;
+    }
+
+    char line[CONTROL_LINE_MAX];
+    int status;
+    while ((status = control_read_line(app_data->clients[index], line, sizeof(line))) > 0) {
+        handle_command(app_data, app_data->clients[index], line);
+    }
+    if (status < 0) {
+        close_client(app_data, index);
+    }
+}
+
+// Function to accept control connections, up to a small limit
+void on_control_socket(int fd, uint32_t events, void *user_data) {
+    AppData *app_data = user_data;
+    ControlClient *client;
+    while ((client = control_accept(fd))) {
+        int index = 0;
+        while (index < MAX_CONTROL_CLIENTS && app_data->clients[index]) {
+            index++;
+        }
+        if (index == MAX_CONTROL_CLIENTS ||
+            event_loop_add(&app_data->loop, client->fd, on_control_client, app_data) != 0) {
+            control_reply(client, "error too many clients");
+            control_close(client);
+            continue;
+        }
+        app_data->clients[index] = client;
+    }
+}
+
+// Function to count finished renderer threads
+void on_renderer_exit(int fd, uint32_t events, void *user_data) {
+    AppData *app_data = user_data;
+    uint64_t count;
+    if (read(fd, &count, sizeof(count)) == sizeof(count)) {
+        app_data->live_renderers -= count;
+    }
+    if (app_data->live_renderers <= 0) {
+        app_data->running = 0;
     }
 }
 
 // Function to handle cleanup
 void cleanup(AppData *app_data) {
-    if (app_data->vertex_buffer) glDeleteBuffers(1, &app_data->vertex_buffer);
-    if (app_data->index_buffer) glDeleteBuffers(1, &app_data->index_buffer);
-    if (app_data->color_buffer) glDeleteBuffers(1, &app_data->color_buffer);
-    if (app_data->color_map) XFreeColormap(app_data->display, app_data->color_map);
-    if (app_data->window) XDestroyWindow(app_data->display, app_data->window);
-    if (app_data->glx_context) glXDestroyContext(app_data->display, app_data->glx_context);
-    if (app_data->visual_info) XFree(app_data->visual_info);
-    if (app_data->screen_info) XFree(app_data->screen_info);
+    for (int i = 0; i < app_data->num_renderers; i++) {
+        renderer_post(&app_data->renderers[i], REQUEST_STOP);
+        renderer_join(&app_data->renderers[i]);
+        renderer_destroy(&app_data->renderers[i]);
+    }
+    free(app_data->renderers);
+    if (app_data->measure_energy) energy_meter_close(&app_data->energy);
+    for (int i = 0; i < app_data->num_groups; i++) {
+        output_group_destroy(&app_data->groups[i]);
+    }
+    free(app_data->groups);
     if (app_data->display) XCloseDisplay(app_data->display);
+    event_loop_destroy(&app_data->loop);
+    sleep_monitor_close(&app_data->sleep_monitor);
+    config_watch_close(&app_data->config_watch);
+    for (int i = 0; i < MAX_CONTROL_CLIENTS; i++) {
+        if (app_data->clients[i]) control_close(app_data->clients[i]);
+    }
+    if (app_data->control_fd >= 0) {
+        close(app_data->control_fd);
+        unlink(app_data->control_path);
+    }
+    if (app_data->exit_fd >= 0) close(app_data->exit_fd);
+    if (app_data->signal_fd >= 0) close(app_data->signal_fd);
+}
+
+// Function to set up one output group per X screen and count their outputs.
+// Returns the total number of outputs, or -1 on failure.
+int setup_groups(AppData *app_data, int first, int count) {
+    app_data->groups = calloc(count, sizeof(OutputGroup));
+    if (!app_data->groups) {
+        return -1;
+    }
+    int total = 0;
+    for (int i = 0; i < count; i++) {
+        XineramaScreenInfo *monitors;
+        int num_outputs = query_monitors(app_data->display, first + i, app_data->options.split, &monitors);
+        if (num_outputs <= 0) {
+            fprintf(stderr, "Failed to query monitors of screen %d\n", first + i);
+            return -1;
+        }
+        free(monitors);
+        if (output_group_init(&app_data->groups[i], app_data->display, first + i, num_outputs) != 0) {
+            return -1;
+        }
+        app_data->num_groups++;
+        total += num_outputs;
+    }
+    return total;
 }
 
-// Function to initialize X11 and OpenGL
+// Function to start one renderer per X screen, or per monitor
 int initialize(AppData *app_data) {
-    // Open a connection to the X server
-    app_data->display = XOpenDisplay(NULL);
-    if (!app_data->display) {
+    // Without output groups this is only used to count the X screens, as
+    // every renderer opens its own connection
+    Display *display = XOpenDisplay(NULL);
+    if (!display) {
         fprintf(stderr, "Failed to open X display\n");
         return -1;
     }
+    int screen_count = ScreenCount(display);
+    if (app_data->options.thread_per_output) {
+        app_data->display = display;
+    } else {
+        XCloseDisplay(display);
+    }
 
-    // Query Xinerama for multi-monitor info
-    int number_of_screens;
-    app_data->screen_info = XineramaQueryScreens(app_data->display, &number_of_screens);
-    if (!app_data->screen_info) {
-        fprintf(stderr, "Failed to query multi-monitor information\n");
-        return -1;
+    int first = 0;
+    int count = screen_count;
+    if (app_data->options.screen >= 0) {
+        if (app_data->options.screen >= screen_count) {
+            fprintf(stderr, "Screen %d does not exist (%d screens)\n", app_data->options.screen, screen_count);
+            return -1;
+        }
+        first = app_data->options.screen;
+        count = 1;
     }
-    app_data->num_screens = number_of_screens;
 
-    // Calculate combined width and height of all monitors
-    int combined_width = 0;
-    int combined_height = 0;
-    for (int i = 0; i < number_of_screens; i++) {
-        combined_width += app_data->screen_info[i].width;
-        combined_height +=
-            (app_data->screen_info[i].height > combined_height) ? app_data->screen_info[i].height : 0;
+    int total = count;
+    if (app_data->options.thread_per_output) {
+        total = setup_groups(app_data, first, count);
+        if (total < 0) {
+            return -1;
+        }
     }
 
-    // Get a suitable visual for OpenGL rendering
-    Window root = DefaultRootWindow(app_data->display);
-    app_data->visual_info = glXChooseVisual(app_data->display, 0, glx_attributes);
-    if (!app_data->visual_info) {
-        fprintf(stderr, "No appropriate visual found\n");
+    app_data->renderers = calloc(total, sizeof(Renderer));
+    if (!app_data->renderers) {
         return -1;
     }
+    if (app_data->options.bench_seconds > 0) {
+        app_data->measure_energy = energy_meter_open(&app_data->energy) == 0;
+    }
+    for (int i = 0; i < count; i++) {
+        int num_outputs = app_data->groups ? app_data->groups[i].num_outputs : 1;
+        for (int output = 0; output < num_outputs; output++) {
+            Renderer *renderer = &app_data->renderers[app_data->num_renderers];
+            if (renderer_create(renderer, &app_data->options, first + i, app_data->exit_fd) != 0) {
+                return -1;
+            }
+            if (app_data->groups) {
+                renderer_set_group(renderer, &app_data->groups[i], output);
+            }
+            if (app_data->measure_energy) {
+                renderer->energy = &app_data->energy;
+            }
+            renderer->record = app_data->options.record_path && app_data->num_renderers == 0;
+            Config config = effective_config(app_data);
+            renderer_set_config(renderer, &config);
+            app_data->num_renderers++;
+        }
+    }
+    for (int i = 0; i < total; i++) {
+        if (renderer_start(&app_data->renderers[i]) != 0) {
+            return -1;
+        }
+        app_data->live_renderers++;
+    }
 
-    // Create a colormap and set window attributes
-    app_data->color_map = XCreateColormap(app_data->display, root, app_data->visual_info->visual, AllocNone);
-    if (!app_data->color_map) {
-        fprintf(stderr, "Failed to create colormap\n");
-        return -1;
+    // A session locked before startup sends no change notification
+    if (app_data->sleep_monitor.locked) {
+        post_all(app_data, REQUEST_LOCK);
     }
-    XSetWindowAttributes window_attributes = {
-        .colormap = app_data->color_map, .event_mask = ExposureMask | KeyPressMask
-    };
+    return 0;
+}
 
-    // Create an X window and set its name
-    app_data->window = XCreateWindow(app_data->display, root, 0, 0, combined_width, combined_height, 0,
-                                     app_data->visual_info->depth, InputOutput, app_data->visual_info->visual,
-                                     CWColormap | CWEventMask, &window_attributes);
-    if (!app_data->window) {
-        fprintf(stderr, "Failed to create window\n");
+// Function to set up the signalfd and epoll set of the main thread
+int setup_event_loop(AppData *app_data, const sigset_t *signals) {
+    if (event_loop_init(&app_data->loop) != 0) {
         return -1;
     }
-    XStoreName(app_data->display, app_data->window, APP_TITLE);
 
-    // Create an OpenGL rendering context
-    app_data->glx_context = glXCreateContext(app_data->display, app_data->visual_info, NULL, GL_TRUE);
-    if (!app_data->glx_context) {
-        fprintf(stderr, "Failed to create GLX context\n");
+    app_data->signal_fd = signalfd(-1, signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (app_data->signal_fd < 0) {
+        perror("signalfd");
         return -1;
     }
 
-    // Set the window type to desktop
-    Atom net_wm_window_type = XInternAtom(app_data->display, "_NET_WM_WINDOW_TYPE", False);
-    Atom net_wm_window_type_desktop =
-        XInternAtom(app_data->display, "_NET_WM_WINDOW_TYPE_DESKTOP", False);
-    XChangeProperty(app_data->display, app_data->window, net_wm_window_type, XA_ATOM, 32,
-                    PropModeReplace, (unsigned char *)&net_wm_window_type_desktop,
-                    1);
-    XMapWindow(app_data->display, app_data->window);
-
-    // Initialize GLEW for OpenGL extensions
-    glXMakeCurrent(app_data->display, app_data->window, app_data->glx_context);
-    if (glewInit() != GLEW_OK) {
-        fprintf(stderr, "Failed to initialize GLEW\n");
+    app_data->exit_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (app_data->exit_fd < 0) {
+        perror("eventfd");
         return -1;
     }
 
-    // Generate and set up the vertex buffer.
-    glGenBuffers(1, &app_data->vertex_buffer);
-    glBindBuffer(GL_ARRAY_BUFFER, app_data->vertex_buffer);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-    glVertexPointer(3, GL_FLOAT, 0, NULL);
-
-    // Generate and set up the index buffer.
-    glGenBuffers(1, &app_data->index_buffer);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, app_data->index_buffer);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices,
-                 GL_STATIC_DRAW);
-
-    // Generate and set up the color buffer.
-    glGenBuffers(1, &app_data->color_buffer);
-    glBindBuffer(GL_ARRAY_BUFFER, app_data->color_buffer);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(colors), colors, GL_STATIC_DRAW);
-    glColorPointer(4, GL_FLOAT, 0, NULL);
-
-    // Enable depth testing and multi-sampling for improved rendering quality.
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_MULTISAMPLE);
+    // The config file is optional; without a config directory to watch it
+    // is only read at startup
+    config_defaults(&app_data->config);
+    if (config_path(app_data->config_path, sizeof(app_data->config_path)) == 0) {
+        // An invalid file is reported and the defaults are used
+        config_load(&app_data->config, app_data->config_path);
+        if (config_watch_open(&app_data->config_watch, app_data->config_path) >= 0 &&
+            event_loop_add(&app_data->loop, app_data->config_watch.fd, on_config_changed, app_data) != 0) {
+            return -1;
+        }
+    }
 
-    // Enable client-side capabilities for vertex and color arrays.
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glEnableClientState(GL_COLOR_ARRAY);
+    // The control socket is optional too, e.g. while another instance runs
+    if (control_socket_path(app_data->control_path, sizeof(app_data->control_path)) == 0) {
+        app_data->control_fd = control_listen(app_data->control_path);
+    }
+    if (app_data->control_fd >= 0 &&
+        event_loop_add(&app_data->loop, app_data->control_fd, on_control_socket, app_data) != 0) {
+        return -1;
+    }
 
-    // Set dark background
-    glClearColor(NORD0);
+    // Sleep notifications are optional, clock gap detection covers resume
+    if (sleep_monitor_open(&app_data->sleep_monitor) >= 0 &&
+        event_loop_add(&app_data->loop, app_data->sleep_monitor.fd, on_sleep_monitor, app_data) != 0) {
+        return -1;
+    }
 
+    if (event_loop_add(&app_data->loop, app_data->signal_fd, on_signal, app_data) != 0 ||
+        event_loop_add(&app_data->loop, app_data->exit_fd, on_renderer_exit, app_data) != 0) {
+        fprintf(stderr, "Failed to set up event loop\n");
+        return -1;
+    }
     return 0;
 }
 
-// Rotation angles for animation
-float rotation_angle_x = 0.0f;
-float rotation_angle_y = 0.0f;
-
-// Update rotation angles for animation
-void update_rotation_angles(float *angle_x, float *angle_y) {
-    *angle_x = fmod(*angle_x + 0.5f, 360.0f);
-    *angle_y = fmod(*angle_y + 0.5f, 360.0f);
-}
+// Function to handle the main thread loop. Rendering happens on the
+// renderer threads; this only waits for signals and renderer exits.
+int main_loop(AppData *app_data) {
+    app_data->running = 1;
+    while (app_data->running) {
+        if (event_loop_dispatch(&app_data->loop, -1) < 0) {
+            break;
+        }
+    }
 
-// Function to handle main rendering loop
-void main_loop(AppData *app_data) {
-    while (!terminate) {
-        struct timespec start_time, end_time;
-
-        // Record start time
-        clock_gettime(CLOCK_MONOTONIC, &start_time);
-
-        // Clear the screen and update rotation angles
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        update_rotation_angles(&rotation_angle_x, &rotation_angle_y);
-
-        // Render cubes: loop through all screens,
-        // set their viewports, and draw cubes.
-        for (int i = 0; i <  app_data->num_screens; i++) {
-
-            // Define the viewport for the current screen
-            glViewport(
-                app_data->screen_info[i].x_org,
-                app_data->screen_info[i].y_org,
-                app_data->screen_info[i].width,
-                app_data->screen_info[i].height
-            );
-
-            // Set projection matrix for perspective rendering
-            glMatrixMode(GL_PROJECTION);
-            glLoadIdentity();
-            gluPerspective(
-                50,
-                (GLfloat)app_data->screen_info[i].width / (GLfloat)app_data->screen_info[i].height,
-                0.1,
-                10.0
-            );
-
-            // Set the model view matrix and define the camera's
-            // position and orientation
-            glMatrixMode(GL_MODELVIEW);
-            glLoadIdentity();
-            gluLookAt(0, 0, 5, 0, 0, 0, 0, 1, 0);
-            glRotatef(rotation_angle_x, 1.0f, 0.0f, 0.0f);
-            glRotatef(rotation_angle_y, 0.0f, 1.0f, 0.0f);
-
-            // Draw the cube
-            glDrawElements(GL_QUADS, 24, GL_UNSIGNED_BYTE, NULL);
+    // Stop and collect all renderers, then report once the energy
+    // measurement, which spans all of them, is complete
+    int status = EXIT_SUCCESS;
+    unsigned long bench_frames = 0;
+    for (int i = 0; i < app_data->num_renderers; i++) {
+        Renderer *renderer = &app_data->renderers[i];
+        renderer_post(renderer, REQUEST_STOP);
+        renderer_join(renderer);
+        if (renderer->status != 0) {
+            status = EXIT_FAILURE;
+        } else {
+            bench_frames += renderer->bench_frames;
+        }
+    }
+    for (int i = 0; i < app_data->num_renderers && app_data->options.bench_seconds > 0; i++) {
+        Renderer *renderer = &app_data->renderers[i];
+        if (renderer->status == 0) {
+            renderer_print_bench(renderer, stdout, bench_frames);
         }
+    }
+    // Energy is system-wide, so it is shared by the frames of all renderers
+    if (app_data->measure_energy && !app_data->options.json) {
+        energy_meter_print(stdout, &app_data->energy, bench_frames);
+    }
+    return status;
+}
 
-        // Swap buffers for double buffering
-        glXSwapBuffers(app_data->display, app_data->window);
+// Function to print command line usage
+void usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -d, --display-lists   compile per-screen view setup and geometry into display lists\n"
+            "  -g, --shaders         render with GLSL programs, cached as binaries across runs\n"
+            "  -c, --cubes N         draw N instanced cubes per monitor (with --shaders)\n"
+            "  -n, --no-state-cache  issue every GL state call, even redundant ones (for comparison)\n"
+            "  -I, --instrument      count GL calls and driver CPU time per frame\n"
+            "  -D, --gl-debug        use a debug context and report driver performance messages\n"
+            "  -P, --perf-counters   sample CPU performance counters of every frame\n"
+            "  -m, --schedule-msc    swap at a target vblank count (GLX_OML_sync_control)\n"
+            "  -L, --late-latch      sample the animation for the predicted presentation time\n"
+            "  -B, --bypass-compositor on|off\n"
+            "                        set _NET_WM_BYPASS_COMPOSITOR to request or refuse unredirection\n"
+            "  -s, --screen N        only render on X screen N (default: all screens)\n"
+            "  -o, --thread-per-output\n"
+            "                        render every monitor from its own thread\n"
+            "  -S, --split N         treat each screen as N side-by-side monitors\n"
+            "  -b, --bench SECONDS   render unpaced for SECONDS, print timings and exit\n"
+            "  -j, --json            print the benchmark report as JSON, one line per renderer\n"
+            "  -r, --record FILE     record the GL calls of the first screen to FILE, for gl_replay\n"
+            "  -F, --record-frames N number of frames to record (default: 300)\n"
+            "  -k, --soak SECONDS    render unpaced for SECONDS, sampling for leaks and drift\n"
+            "  -K, --soak-interval SECONDS\n"
+            "                        seconds between soak samples (default: 60)\n"
+            "  -h, --help            show this help\n",
+            program);
+}
 
-        // Record end time
-        clock_gettime(CLOCK_MONOTONIC, &end_time);
+// Function to parse command line options. Returns -1 on invalid usage.
+int parse_options(AppData *app_data, int argc, char **argv) {
+    static const struct option long_options[] = {
+        {"display-lists", no_argument, NULL, 'd'},
+        {"shaders", no_argument, NULL, 'g'},
+        {"cubes", required_argument, NULL, 'c'},
+        {"no-state-cache", no_argument, NULL, 'n'},
+        {"instrument", no_argument, NULL, 'I'},
+        {"gl-debug", no_argument, NULL, 'D'},
+        {"perf-counters", no_argument, NULL, 'P'},
+        {"schedule-msc", no_argument, NULL, 'm'},
+        {"late-latch", no_argument, NULL, 'L'},
+        {"bypass-compositor", required_argument, NULL, 'B'},
+        {"screen", required_argument, NULL, 's'},
+        {"thread-per-output", no_argument, NULL, 'o'},
+        {"split", required_argument, NULL, 'S'},
+        {"bench", required_argument, NULL, 'b'},
+        {"json", no_argument, NULL, 'j'},
+        {"record", required_argument, NULL, 'r'},
+        {"record-frames", required_argument, NULL, 'F'},
+        {"soak", required_argument, NULL, 'k'},
+        {"soak-interval", required_argument, NULL, 'K'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    int option;
+    while ((option = getopt_long(argc, argv, "dgc:nIDPmLB:s:oS:b:jr:F:k:K:h", long_options, NULL)) != -1) {
+        switch (option) {
+        case 'd':
+            app_data->options.use_display_lists = 1;
+            break;
+        case 'g':
+            app_data->options.use_shaders = 1;
+            break;
+        case 'c':
+            if (parse_integer(optarg, 1, 1000000, &app_data->options.cubes) != 0) {
+                fprintf(stderr, "Invalid number of cubes: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'n':
+            app_data->options.no_state_cache = 1;
+            break;
+        case 'I':
+            app_data->options.instrument = 1;
+            break;
+        case 'D':
+            app_data->options.gl_debug = 1;
+            break;
+        case 'P':
+            app_data->options.perf_counters = 1;
+            break;
+        case 'm':
+            app_data->options.schedule_msc = 1;
+            break;
+        case 'L':
+            app_data->options.late_latch = 1;
+            break;
+        case 'B':
+            if (strcmp(optarg, "on") == 0) {
+                app_data->options.bypass_compositor = BYPASS_REQUEST;
+            } else if (strcmp(optarg, "off") == 0) {
+                app_data->options.bypass_compositor = BYPASS_DISABLE;
+            } else {
+                fprintf(stderr, "Invalid bypass mode: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 's':
+            if (parse_integer(optarg, 0, INT_MAX, &app_data->options.screen) != 0) {
+                fprintf(stderr, "Invalid screen: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'o':
+            app_data->options.thread_per_output = 1;
+            break;
+        case 'S':
+            if (parse_integer(optarg, 1, INT_MAX, &app_data->options.split) != 0) {
+                fprintf(stderr, "Invalid number of outputs: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'b':
+            if (parse_number(optarg, &app_data->options.bench_seconds) != 0 ||
+                app_data->options.bench_seconds <= 0) {
+                fprintf(stderr, "Invalid benchmark duration: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'j':
+            app_data->options.json = 1;
+            break;
+        case 'r':
+            app_data->options.record_path = optarg;
+            break;
+        case 'F': {
+            int frames;
+            if (parse_integer(optarg, 1, INT_MAX, &frames) != 0) {
+                fprintf(stderr, "Invalid number of frames: %s\n", optarg);
+                return -1;
+            }
+            app_data->options.record_frames = frames;
+            break;
+        }
+        case 'k':
+            if (parse_number(optarg, &app_data->options.soak_seconds) != 0 ||
+                app_data->options.soak_seconds <= 0) {
+                fprintf(stderr, "Invalid soak duration: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'K':
+            if (parse_number(optarg, &app_data->options.soak_interval) != 0 ||
+                app_data->options.soak_interval <= 0) {
+                fprintf(stderr, "Invalid soak interval: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'h':
+            usage(argv[0]);
+            exit(EXIT_SUCCESS);
+        default:
+            usage(argv[0]);
+            return -1;
+        }
+    }
 
-        // Calculate time taken for the frame
-        int frame_time_elapsed = (end_time.tv_sec - start_time.tv_sec) * 1000000 +
-                                 (end_time.tv_nsec - start_time.tv_nsec) / 1000;
+    // Programs are not part of the recording, so only the fixed-function
+    // paths can be replayed
+    if (app_data->options.record_path && app_data->options.use_shaders) {
+        fprintf(stderr, "Recording is not supported with --shaders\n");
+        return -1;
+    }
+    // Instances are placed by the vertex shaders and drawn from the buffers
+    if (app_data->options.cubes > 1 &&
+        (!app_data->options.use_shaders || app_data->options.use_display_lists)) {
+        fprintf(stderr, "--cubes needs --shaders and cannot be combined with --display-lists\n");
+        return -1;
+    }
+    if (!app_data->options.record_frames) {
+        app_data->options.record_frames = 300;
+    }
 
-        // Calculate remaining time to delay to achieve the target frame duration
-        int time_to_sleep = TARGET_FRAME_DURATION - frame_time_elapsed;
-        if (time_to_sleep > 0) {
-            usleep(time_to_sleep);
-        }
-        XFlush(app_data->display);
+    // Soak runs recreate the context, which outputs sharing objects with
+    // their group cannot do
+    if (app_data->options.soak_seconds > 0 &&
+        (app_data->options.bench_seconds > 0 || app_data->options.thread_per_output)) {
+        fprintf(stderr, "--soak cannot be combined with --bench or --thread-per-output\n");
+        return -1;
     }
+    if (!app_data->options.soak_interval) {
+        app_data->options.soak_interval = 60;
+    }
+    return 0;
 }
 
-int main(void) {
+int main(int argc, char **argv) {
     AppData app_data = {0};
+    app_data.options.screen = -1;
+    app_data.options.cubes = 1;
+    if (parse_options(&app_data, argc, argv) != 0) {
+        exit(EXIT_FAILURE);
+    }
 
-    // Register signal handlers
-    signal(SIGINT, signal_handler);
-    signal(SIGTERM, signal_handler);
-
-    if (initialize(&app_data) != 0) {
+    app_data.loop.epoll_fd = -1;
+    app_data.signal_fd = -1;
+    app_data.exit_fd = -1;
+    app_data.sleep_monitor.fd = -1;
+    app_data.config_watch.fd = -1;
+    app_data.control_fd = -1;
+    app_data.fps_override = -1;
+    app_data.samples_override = -1;
+
+    // Renderers use Xlib and GLX from their own threads
+    XInitThreads();
+
+    // Block the signals we handle so they are only delivered via signalfd.
+    // Renderer threads inherit the mask, so only the main thread sees them.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGHUP);
+    sigaddset(&signals, SIGUSR1);
+    sigprocmask(SIG_BLOCK, &signals, NULL);
+
+    if (setup_event_loop(&app_data, &signals) != 0 || initialize(&app_data) != 0) {
         fprintf(stderr, "Initialization failed\n");
         cleanup(&app_data);
         exit(EXIT_FAILURE);
     }
-    main_loop(&app_data);
+    int status = main_loop(&app_data);
     cleanup(&app_data);
-    exit(EXIT_SUCCESS);
+    exit(status);
 }
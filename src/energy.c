@@ -0,0 +1,247 @@
+/**
+ * Energy measurement for benchmarks, see energy.h.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <string.h>
+#include <time.h>
+
+#include "energy.h"
+#include "scheduler.h"
+
+#define POWERCAP_DIR "/sys/class/powercap"
+#define HWMON_DIR "/sys/class/hwmon"
+
+static const char *domain_names[ENERGY_DOMAINS] = {"package", "core"};
+
+// Function to read the first line of a sysfs file, without the newline.
+// Returns -1 with errno set on failure.
+static int read_line(const char *path, char *buffer, size_t size) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return -1;
+    }
+    int status = fgets(buffer, size, file) ? 0 : -1;
+    if (status != 0) {
+        errno = EIO;
+    }
+    fclose(file);
+    buffer[strcspn(buffer, "\n")] = '\0';
+    return status;
+}
+
+// Function to read a counter in microjoules. Returns -1 on failure.
+static int read_counter(const char *path, uint64_t *value) {
+    char line[32];
+    if (read_line(path, line, sizeof(line)) != 0) {
+        return -1;
+    }
+    return sscanf(line, "%" SCNu64, value) == 1 ? 0 : -1;
+}
+
+// Function to add a counter if it can be read. Returns -1 if it exists but
+// reading it is not permitted.
+static int add_counter(EnergyMeter *meter, int domain, const char *path, uint64_t range) {
+    uint64_t value;
+    if (meter->num_counters == MAX_ENERGY_COUNTERS) {
+        return 0;
+    }
+    if (read_counter(path, &value) != 0) {
+        return errno == EACCES || errno == EPERM ? -1 : 0;
+    }
+    EnergyCounter *counter = &meter->counters[meter->num_counters++];
+    counter->domain = domain;
+    snprintf(counter->path, sizeof(counter->path), "%s", path);
+    counter->range = range;
+    return 0;
+}
+
+// Function to find the package and core zones of every socket. Zones are
+// named intel-rapl:<socket> ("package-<n>") with subzones
+// intel-rapl:<socket>:<n> ("core", "uncore", "dram").
+static int find_powercap(EnergyMeter *meter) {
+    DIR *directory = opendir(POWERCAP_DIR);
+    if (!directory) {
+        return 0;
+    }
+    int denied = 0;
+    struct dirent *entry;
+    while ((entry = readdir(directory))) {
+        if (strncmp(entry->d_name, "intel-rapl:", 11) != 0) {
+            continue;
+        }
+        char path[512], name[64], range[32];
+        snprintf(path, sizeof(path), POWERCAP_DIR "/%s/name", entry->d_name);
+        if (read_line(path, name, sizeof(name)) != 0) {
+            continue;
+        }
+        int domain;
+        if (strncmp(name, "package-", 8) == 0) {
+            domain = ENERGY_PACKAGE;
+        } else if (strcmp(name, "core") == 0) {
+            domain = ENERGY_CORE;
+        } else {
+            continue;
+        }
+        uint64_t max_range = 0;
+        snprintf(path, sizeof(path), POWERCAP_DIR "/%s/max_energy_range_uj", entry->d_name);
+        if (read_line(path, range, sizeof(range)) == 0) {
+            sscanf(range, "%" SCNu64, &max_range);
+        }
+        snprintf(path, sizeof(path), POWERCAP_DIR "/%s/energy_uj", entry->d_name);
+        denied |= add_counter(meter, domain, path, max_range) != 0;
+    }
+    closedir(directory);
+    if (meter->num_counters > 0) {
+        meter->source = "RAPL";
+    }
+    return denied ? -1 : 0;
+}
+
+// Function to find the amd_energy hwmon counters (Linux 5.8 to 5.17), one
+// per socket ("Esocket<n>") and per core ("Ecore<n>"). These are 64-bit
+// and do not wrap.
+static int find_amd_energy(EnergyMeter *meter) {
+    DIR *directory = opendir(HWMON_DIR);
+    if (!directory) {
+        return 0;
+    }
+    int denied = 0;
+    struct dirent *entry;
+    while ((entry = readdir(directory))) {
+        char path[512], name[64];
+        snprintf(path, sizeof(path), HWMON_DIR "/%s/name", entry->d_name);
+        if (entry->d_name[0] == '.' || read_line(path, name, sizeof(name)) != 0 ||
+            strcmp(name, "amd_energy") != 0) {
+            continue;
+        }
+        for (int i = 1;; i++) {
+            char label[32];
+            snprintf(path, sizeof(path), HWMON_DIR "/%s/energy%d_label", entry->d_name, i);
+            if (read_line(path, label, sizeof(label)) != 0) {
+                break;
+            }
+            int domain = strncmp(label, "Esocket", 7) == 0 ? ENERGY_PACKAGE : ENERGY_CORE;
+            snprintf(path, sizeof(path), HWMON_DIR "/%s/energy%d_input", entry->d_name, i);
+            denied |= add_counter(meter, domain, path, 0) != 0;
+        }
+    }
+    closedir(directory);
+    if (meter->num_counters > 0) {
+        meter->source = "amd_energy";
+    }
+    return denied ? -1 : 0;
+}
+
+// Function to find the energy counters. Returns -1, with a note if they
+// exist but cannot be read, when there are none. The lock is only set up
+// for a usable meter, which energy_meter_close() releases.
+int energy_meter_open(EnergyMeter *meter) {
+    memset(meter, 0, sizeof(*meter));
+    int denied = find_powercap(meter);
+    if (meter->num_counters == 0) {
+        denied |= find_amd_energy(meter);
+    }
+    if (meter->num_counters == 0) {
+        // Since Linux 5.10 the RAPL counters are only readable by root
+        if (denied) {
+            fprintf(stderr, "Energy counters are not readable (root only), no energy measurement\n");
+        }
+        return -1;
+    }
+    pthread_mutex_init(&meter->lock, NULL);
+    return 0;
+}
+
+// Function to start measuring, if no other renderer has yet
+void energy_meter_begin(EnergyMeter *meter) {
+    pthread_mutex_lock(&meter->lock);
+    if (meter->active++ == 0) {
+        for (int i = 0; i < meter->num_counters; i++) {
+            read_counter(meter->counters[i].path, &meter->counters[i].start);
+        }
+        meter->start_time = clock_seconds(CLOCK_MONOTONIC);
+    }
+    pthread_mutex_unlock(&meter->lock);
+}
+
+// Function to stop measuring once the last renderer is done
+void energy_meter_end(EnergyMeter *meter) {
+    pthread_mutex_lock(&meter->lock);
+    if (--meter->active == 0) {
+        meter->elapsed += clock_seconds(CLOCK_MONOTONIC) - meter->start_time;
+        for (int i = 0; i < meter->num_counters; i++) {
+            EnergyCounter *counter = &meter->counters[i];
+            uint64_t value;
+            if (read_counter(counter->path, &value) != 0) {
+                continue;
+            }
+            // RAPL counters wrap at max_energy_range_uj, within minutes
+            // at high power
+            if (value < counter->start && counter->range > 0) {
+                value += counter->range;
+            }
+            counter->total += value - counter->start;
+        }
+    }
+    pthread_mutex_unlock(&meter->lock);
+}
+
+// Function to print the energy used, in total and per frame of all
+// renderers
+void energy_meter_print(FILE *stream, EnergyMeter *meter, unsigned long frames) {
+    pthread_mutex_lock(&meter->lock);
+    if (meter->num_counters > 0 && meter->elapsed > 0 && frames > 0) {
+        for (int domain = 0; domain < ENERGY_DOMAINS; domain++) {
+            uint64_t microjoules = 0;
+            int found = 0;
+            for (int i = 0; i < meter->num_counters; i++) {
+                if (meter->counters[i].domain == domain) {
+                    microjoules += meter->counters[i].total;
+                    found = 1;
+                }
+            }
+            if (found) {
+                double joules = microjoules / 1e6;
+                fprintf(stream, "energy (%s %s): %.2f J in %.2fs, %.2f W, %.3f mJ per frame\n", meter->source,
+                        domain_names[domain], joules, meter->elapsed, joules / meter->elapsed,
+                        joules * 1000.0 / frames);
+            }
+        }
+    }
+    pthread_mutex_unlock(&meter->lock);
+}
+
+// Function to print the energy used per domain as flat JSON members: in
+// total, as average power and per frame of all renderers. A null meter or a
+// domain without counters gives nulls.
+void energy_meter_print_json(FILE *stream, EnergyMeter *meter, unsigned long frames) {
+    if (meter) pthread_mutex_lock(&meter->lock);
+    for (int domain = 0; domain < ENERGY_DOMAINS; domain++) {
+        uint64_t microjoules = 0;
+        int found = 0;
+        for (int i = 0; meter && i < meter->num_counters; i++) {
+            if (meter->counters[i].domain == domain) {
+                microjoules += meter->counters[i].total;
+                found = 1;
+            }
+        }
+        const char *name = domain_names[domain];
+        if (found && meter->elapsed > 0 && frames > 0) {
+            double joules = microjoules / 1e6;
+            fprintf(stream, ",\"energy_%s_j\":%.3f,\"power_%s_w\":%.3f,\"energy_%s_mj_per_frame\":%.4f", name,
+                    joules, name, joules / meter->elapsed, name, joules * 1000.0 / frames);
+        } else {
+            fprintf(stream, ",\"energy_%s_j\":null,\"power_%s_w\":null,\"energy_%s_mj_per_frame\":null", name,
+                    name, name);
+        }
+    }
+    if (meter) pthread_mutex_unlock(&meter->lock);
+}
+
+// Function to release the meter
+void energy_meter_close(EnergyMeter *meter) {
+    pthread_mutex_destroy(&meter->lock);
+}
@@ -0,0 +1,53 @@
+/**
+ * Energy measurement for benchmarks.
+ *
+ * Reads the cumulative energy counters of the CPU package and cores from
+ * the powercap RAPL zones (/sys/class/powercap/intel-rapl*, which the
+ * kernel also provides for AMD Zen CPUs), or from the amd_energy hwmon
+ * driver of older kernels. The counters cover the whole system, so with
+ * several renderers the measurement spans from the first renderer starting
+ * its benchmark to the last one finishing it.
+ */
+
+#ifndef ENERGY_H
+#define ENERGY_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define MAX_ENERGY_COUNTERS 16
+
+enum {
+    ENERGY_PACKAGE,
+    ENERGY_CORE,
+    ENERGY_DOMAINS
+};
+
+typedef struct {
+    int domain;
+    char path[512];
+    uint64_t range;     // Value at which the counter wraps, 0 if it does not
+    uint64_t start;     // Microjoules at the start of the measurement
+    uint64_t total;     // Microjoules measured
+} EnergyCounter;
+
+typedef struct {
+    const char *source;
+    EnergyCounter counters[MAX_ENERGY_COUNTERS];
+    int num_counters;
+
+    pthread_mutex_t lock;
+    int active;         // Renderers currently benchmarking
+    double start_time;
+    double elapsed;
+} EnergyMeter;
+
+int energy_meter_open(EnergyMeter *meter);
+void energy_meter_begin(EnergyMeter *meter);
+void energy_meter_end(EnergyMeter *meter);
+void energy_meter_print(FILE *stream, EnergyMeter *meter, unsigned long frames);
+void energy_meter_print_json(FILE *stream, EnergyMeter *meter, unsigned long frames);
+void energy_meter_close(EnergyMeter *meter);
+
+#endif
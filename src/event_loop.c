@@ -0,0 +1,98 @@
+/**
+ * Minimal epoll-based event loop, see event_loop.h.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <sys/epoll.h>
+
+#include "event_loop.h"
+
+#define MAX_EVENTS 16
+
+struct EventSource {
+    int fd;
+    EventCallback callback;
+    void *user_data;
+    EventSource *next;
+};
+
+// Function to create the epoll set
+int event_loop_init(EventLoop *loop) {
+    loop->sources = NULL;
+    loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop->epoll_fd < 0) {
+        perror("epoll_create1");
+        return -1;
+    }
+    return 0;
+}
+
+// Function to watch a file descriptor for readability
+int event_loop_add(EventLoop *loop, int fd, EventCallback callback, void *user_data) {
+    EventSource *source = calloc(1, sizeof(*source));
+    if (!source) {
+        return -1;
+    }
+    source->fd = fd;
+    source->callback = callback;
+    source->user_data = user_data;
+
+    struct epoll_event event = {.events = EPOLLIN, .data.ptr = source};
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+        perror("epoll_ctl");
+        free(source);
+        return -1;
+    }
+    source->next = loop->sources;
+    loop->sources = source;
+    return 0;
+}
+
+// Function to stop watching a file descriptor (the fd itself is not closed)
+void event_loop_remove(EventLoop *loop, int fd) {
+    for (EventSource **link = &loop->sources; *link; link = &(*link)->next) {
+        EventSource *source = *link;
+        if (source->fd == fd) {
+            epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+            *link = source->next;
+            free(source);
+            return;
+        }
+    }
+}
+
+// Function to wait for and dispatch ready sources. Returns the number of
+// dispatched sources, 0 on timeout or interruption, -1 on error.
+int event_loop_dispatch(EventLoop *loop, int timeout_ms) {
+    struct epoll_event events[MAX_EVENTS];
+    int count = epoll_wait(loop->epoll_fd, events, MAX_EVENTS, timeout_ms);
+    if (count < 0) {
+        if (errno == EINTR) {
+            return 0;
+        }
+        perror("epoll_wait");
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        EventSource *source = events[i].data.ptr;
+        source->callback(source->fd, events[i].events, source->user_data);
+    }
+    return count;
+}
+
+// Function to release the epoll set and all registrations
+void event_loop_destroy(EventLoop *loop) {
+    while (loop->sources) {
+        EventSource *next = loop->sources->next;
+        free(loop->sources);
+        loop->sources = next;
+    }
+    if (loop->epoll_fd >= 0) {
+        close(loop->epoll_fd);
+    }
+    loop->epoll_fd = -1;
+}
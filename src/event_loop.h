@@ -0,0 +1,29 @@
+/**
+ * Minimal epoll-based event loop.
+ *
+ * Every source of work (signals, frame timer, X connection, control sockets)
+ * is a file descriptor registered here with a callback, so the process only
+ * wakes up when one of them is actually readable.
+ */
+
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <stdint.h>
+
+typedef void (*EventCallback)(int fd, uint32_t events, void *user_data);
+
+typedef struct EventSource EventSource;
+
+typedef struct {
+    int epoll_fd;
+    EventSource *sources;
+} EventLoop;
+
+int event_loop_init(EventLoop *loop);
+int event_loop_add(EventLoop *loop, int fd, EventCallback callback, void *user_data);
+void event_loop_remove(EventLoop *loop, int fd);
+int event_loop_dispatch(EventLoop *loop, int timeout_ms);
+void event_loop_destroy(EventLoop *loop);
+
+#endif
@@ -0,0 +1,112 @@
+/**
+ * Frame timing statistics, see frame_stats.h.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "frame_stats.h"
+
+// Function to record a sample, overwriting the oldest one when full
+void series_add(SampleSeries *series, double value) {
+    series->samples[series->count % SAMPLE_WINDOW] = value;
+    series->count++;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Function to pick a percentile from sorted samples (nearest rank)
+static double percentile(const double *sorted, unsigned long count, double fraction) {
+    unsigned long rank = (unsigned long)ceil(fraction * count);
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+// Function to summarize the samples currently in the window
+void series_summarize(const SampleSeries *series, SeriesSummary *summary) {
+    memset(summary, 0, sizeof(*summary));
+    unsigned long count = series->count < SAMPLE_WINDOW ? series->count : SAMPLE_WINDOW;
+    if (count == 0) {
+        return;
+    }
+
+    double *sorted = malloc(count * sizeof(double));
+    if (!sorted) {
+        return;
+    }
+    memcpy(sorted, series->samples, count * sizeof(double));
+    qsort(sorted, count, sizeof(double), compare_doubles);
+
+    double sum = 0.0;
+    double sum_squares = 0.0;
+    for (unsigned long i = 0; i < count; i++) {
+        sum += sorted[i];
+        sum_squares += sorted[i] * sorted[i];
+    }
+    summary->count = count;
+    summary->mean = sum / count;
+    summary->stddev = sqrt(fmax(sum_squares / count - summary->mean * summary->mean, 0.0));
+    summary->p50 = percentile(sorted, count, 0.50);
+    summary->p90 = percentile(sorted, count, 0.90);
+    summary->p99 = percentile(sorted, count, 0.99);
+    summary->max = sorted[count - 1];
+    free(sorted);
+}
+
+// Function to print a one-line summary of a series
+void series_print(FILE *stream, const char *name, const SampleSeries *series) {
+    SeriesSummary summary;
+    series_summarize(series, &summary);
+    if (summary.count == 0) {
+        fprintf(stream, "%s: no samples\n", name);
+        return;
+    }
+    fprintf(stream,
+            "%s: mean %.3f, p50 %.3f, p90 %.3f, p99 %.3f, max %.3f, jitter (stddev) %.3f ms "
+            "[%lu samples]\n",
+            name, summary.mean, summary.p50, summary.p90, summary.p99, summary.max, summary.stddev,
+            summary.count);
+}
+
+// Function to clear all samples and counters
+void frame_stats_reset(FrameStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+}
+
+// Function to print the frame statistics
+void frame_stats_print(FILE *stream, const FrameStats *stats) {
+    series_print(stream, "cpu frame time", &stats->cpu_time);
+    if (stats->gpu_time.count > 0) {
+        series_print(stream, "gpu frame time", &stats->gpu_time);
+    }
+    if (stats->state_frames > 0) {
+        unsigned long total = stats->state_issued + stats->state_filtered;
+        fprintf(stream, "GL state calls per frame: %.1f issued, %.1f filtered (%.0f%%)\n",
+                (double)stats->state_issued / stats->state_frames,
+                (double)stats->state_filtered / stats->state_frames,
+                total ? 100.0 * stats->state_filtered / total : 0.0);
+    }
+    if (stats->driver_frames > 0) {
+        series_print(stream, "GL driver time", &stats->driver_time);
+        for (int i = 0; i < GL_CATEGORIES; i++) {
+            fprintf(stream, "GL %s: %.1f calls, %.3f ms per frame\n", gl_category_names[i],
+                    (double)stats->driver_calls[i] / stats->driver_frames,
+                    stats->driver_seconds[i] * 1000.0 / stats->driver_frames);
+        }
+        fprintf(stream, "GL upload: %.0f bytes per frame\n", (double)stats->upload_bytes / stats->driver_frames);
+    }
+    if (stats->presented == 0) {
+        fprintf(stream, "present interval: no presentation feedback\n");
+        return;
+    }
+    series_print(stream, "present interval", &stats->present_interval);
+    if (stats->latch_error.count > 0) {
+        series_print(stream, "late-latch prediction error", &stats->latch_error);
+    }
+    fprintf(stream, "presented: %lu, late: %lu\n", stats->presented, stats->late);
+}
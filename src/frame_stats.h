@@ -0,0 +1,55 @@
+/**
+ * Frame timing statistics.
+ *
+ * Keeps a window of recent samples per series and summarizes them into
+ * percentiles on demand (for SIGUSR1 dumps and benchmark reports).
+ */
+
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include <stdio.h>
+
+#include "gl_instrument.h"
+
+#define SAMPLE_WINDOW 4096
+
+typedef struct {
+    double samples[SAMPLE_WINDOW];
+    unsigned long count;
+} SampleSeries;
+
+typedef struct {
+    unsigned long count;
+    double mean;
+    double stddev;
+    double p50;
+    double p90;
+    double p99;
+    double max;
+} SeriesSummary;
+
+typedef struct {
+    SampleSeries cpu_time;          // Frame start to swap submission, ms
+    SampleSeries gpu_time;          // GPU time of the frame's commands, ms
+    SampleSeries present_interval;  // Between actual presentations, ms
+    SampleSeries latch_error;       // Actual minus predicted presentation, ms
+    unsigned long presented;
+    unsigned long late;             // Presentations that missed their vblank
+    unsigned long state_frames;     // Frames counted in the GL state call totals
+    unsigned long state_issued;     // State calls that reached the driver
+    unsigned long state_filtered;   // Redundant state calls dropped
+    SampleSeries driver_time;       // CPU time inside instrumented GL calls, ms
+    unsigned long driver_frames;    // Frames counted in the driver totals
+    unsigned long driver_calls[GL_CATEGORIES];
+    double driver_seconds[GL_CATEGORIES];
+    unsigned long upload_bytes;
+} FrameStats;
+
+void series_add(SampleSeries *series, double value);
+void series_summarize(const SampleSeries *series, SeriesSummary *summary);
+void series_print(FILE *stream, const char *name, const SampleSeries *series);
+void frame_stats_reset(FrameStats *stats);
+void frame_stats_print(FILE *stream, const FrameStats *stats);
+
+#endif
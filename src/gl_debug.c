@@ -0,0 +1,154 @@
+/**
+ * GL debug output, see gl_debug.h.
+ */
+
+#include <string.h>
+
+#include "gl_debug.h"
+#include "present.h"
+
+typedef GLXContext (*CreateContextAttribsProc)(Display *, GLXFBConfig, GLXContext, Bool, const int *);
+
+// Function to prepare the message table. Counts are kept across contexts.
+void gl_debug_init(GlDebug *debug) {
+    memset(debug, 0, sizeof(*debug));
+    pthread_mutex_init(&debug->lock, NULL);
+}
+
+// Function to find the framebuffer config behind a visual
+static GLXFBConfig find_fb_config(Display *display, XVisualInfo *visual_info) {
+    int count = 0;
+    GLXFBConfig *configs = glXGetFBConfigs(display, visual_info->screen, &count);
+    GLXFBConfig config = NULL;
+    for (int i = 0; i < count && !config; i++) {
+        int visual_id;
+        if (glXGetFBConfigAttrib(display, configs[i], GLX_VISUAL_ID, &visual_id) == Success &&
+            (VisualID)visual_id == visual_info->visualid) {
+            config = configs[i];
+        }
+    }
+    if (configs) XFree(configs);
+    return config;
+}
+
+// Function to create a debug context for a visual. Without
+// GLX_ARB_create_context this falls back to a regular context, where many
+// drivers still deliver debug output.
+GLXContext gl_debug_create_context(Display *display, XVisualInfo *visual_info, GLXContext share_context) {
+    static const int attributes[] = {
+        GLX_CONTEXT_FLAGS_ARB, GLX_CONTEXT_DEBUG_BIT_ARB,
+        None
+    };
+    CreateContextAttribsProc create_context_attribs = NULL;
+    GLXFBConfig config = NULL;
+    if (has_glx_extension(display, visual_info->screen, "GLX_ARB_create_context")) {
+        create_context_attribs =
+            (CreateContextAttribsProc)glXGetProcAddressARB((const GLubyte *)"glXCreateContextAttribsARB");
+        config = find_fb_config(display, visual_info);
+    }
+    if (!create_context_attribs || !config) {
+        fprintf(stderr, "GLX_ARB_create_context not available, GL debug output without a debug context\n");
+        return glXCreateContext(display, visual_info, share_context, GL_TRUE);
+    }
+    return create_context_attribs(display, config, share_context, True, attributes);
+}
+
+// Function to log and count a message from the driver
+static void GLAPIENTRY on_debug_message(GLenum source, GLenum type, GLuint id, GLenum severity,
+                                        GLsizei length, const GLchar *message, const void *user_data) {
+    (void)type;
+    (void)length;
+    GlDebug *debug = (GlDebug *)user_data;
+    char text[sizeof(debug->messages[0].text)];
+    text[0] = '\0';
+    pthread_mutex_lock(&debug->lock);
+    debug->total++;
+
+    // Drivers reuse ids for messages with different details, so the text
+    // is part of the key
+    GlDebugMessage *entry = NULL;
+    for (int i = 0; i < debug->num_messages && !entry; i++) {
+        GlDebugMessage *candidate = &debug->messages[i];
+        if (candidate->source == source && candidate->id == id &&
+            strncmp(candidate->text, message, sizeof(candidate->text) - 1) == 0) {
+            entry = candidate;
+        }
+    }
+    if (entry) {
+        entry->count++;
+    } else if (debug->num_messages < GL_DEBUG_MESSAGES) {
+        entry = &debug->messages[debug->num_messages++];
+        entry->source = source;
+        entry->id = id;
+        entry->severity = severity;
+        entry->count = 1;
+        snprintf(entry->text, sizeof(entry->text), "%s", message);
+        snprintf(text, sizeof(text), "%s", message);
+    } else {
+        debug->untracked++;
+    }
+    pthread_mutex_unlock(&debug->lock);
+
+    // Printed without the lock held, since gl_debug_report() takes it while
+    // holding the stream's lock
+    if (text[0]) {
+        fprintf(stderr, "GL performance warning: %s\n", text);
+    }
+}
+
+// Function to install the message callback in the current context, with
+// only performance messages enabled. Messages are delivered synchronously, on
+// the thread that issued the call, so they can be tied to the frame that
+// caused them. Returns -1 without KHR_debug.
+int gl_debug_start(GlDebug *debug) {
+    debug->active = 0;
+    if (!GLEW_KHR_debug && !GLEW_VERSION_4_3) {
+        fprintf(stderr, "GL_KHR_debug not available, no GL debug output\n");
+        return -1;
+    }
+    GLint flags = 0;
+    glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
+    if (!(flags & GL_CONTEXT_FLAG_DEBUG_BIT)) {
+        fprintf(stderr, "Not a debug context, the driver may omit debug messages\n");
+    }
+
+    glDebugMessageCallback(on_debug_message, debug);
+    glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, NULL, GL_FALSE);
+    glDebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_PERFORMANCE, GL_DONT_CARE, 0, NULL, GL_TRUE);
+    glEnable(GL_DEBUG_OUTPUT);
+    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    debug->active = 1;
+    return 0;
+}
+
+// Function to open a named debug group, if debug output is active
+void gl_debug_push_group(const GlDebug *debug, GLuint id, const char *name) {
+    if (debug->active) {
+        glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, id, -1, name);
+    }
+}
+
+// Function to close the innermost debug group
+void gl_debug_pop_group(const GlDebug *debug) {
+    if (debug->active) {
+        glPopDebugGroup();
+    }
+}
+
+// Function to print the counted performance messages
+void gl_debug_report(GlDebug *debug, FILE *stream) {
+    pthread_mutex_lock(&debug->lock);
+    fprintf(stream, "GL performance messages: %lu (%d distinct)\n", debug->total, debug->num_messages);
+    for (int i = 0; i < debug->num_messages; i++) {
+        fprintf(stream, "  %6lu x %s\n", debug->messages[i].count, debug->messages[i].text);
+    }
+    if (debug->untracked) {
+        fprintf(stream, "  %6lu x (other messages)\n", debug->untracked);
+    }
+    pthread_mutex_unlock(&debug->lock);
+}
+
+// Function to free the message table's lock
+void gl_debug_destroy(GlDebug *debug) {
+    pthread_mutex_destroy(&debug->lock);
+}
@@ -0,0 +1,47 @@
+/**
+ * GL debug output (KHR_debug) with a debug context.
+ *
+ * Performance messages from the driver (implicit synchronization, buffer
+ * reallocation, software fallbacks, ...) are logged the first time they
+ * occur and counted afterwards, so a message issued every frame does not
+ * flood the log. Debug groups annotate the frame structure for tools like
+ * apitrace or RenderDoc.
+ */
+
+#ifndef GL_DEBUG_H
+#define GL_DEBUG_H
+
+#include <pthread.h>
+#include <stdio.h>
+
+#include <GL/glew.h>
+#include <GL/glx.h>
+
+#define GL_DEBUG_MESSAGES 32
+
+typedef struct {
+    GLenum source;
+    GLuint id;
+    GLenum severity;
+    unsigned long count;
+    char text[160];
+} GlDebugMessage;
+
+typedef struct {
+    int active;             // Callback installed in the current context
+    pthread_mutex_t lock;   // The driver may call back from its own threads
+    GlDebugMessage messages[GL_DEBUG_MESSAGES];
+    int num_messages;
+    unsigned long total;
+    unsigned long untracked;  // Messages beyond the table, counted only
+} GlDebug;
+
+void gl_debug_init(GlDebug *debug);
+GLXContext gl_debug_create_context(Display *display, XVisualInfo *visual_info, GLXContext share_context);
+int gl_debug_start(GlDebug *debug);
+void gl_debug_push_group(const GlDebug *debug, GLuint id, const char *name);
+void gl_debug_pop_group(const GlDebug *debug);
+void gl_debug_report(GlDebug *debug, FILE *stream);
+void gl_debug_destroy(GlDebug *debug);
+
+#endif
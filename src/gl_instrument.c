@@ -0,0 +1,36 @@
+/**
+ * Optional per-frame instrumentation of GL calls, see gl_instrument.h.
+ */
+
+#include <time.h>
+
+#include "gl_instrument.h"
+#include "scheduler.h"
+
+const char *const gl_category_names[GL_CATEGORIES] = {"state", "draw", "upload", "swap"};
+
+_Thread_local GlCounters *gl_counters;
+
+// Function to start (or with NULL, stop) counting the calling thread's GL
+// calls
+void gl_instrument_attach(GlCounters *counters) {
+    gl_counters = counters;
+}
+
+// Function to take the start time of an instrumented call
+double gl_instrument_begin(void) {
+    return clock_seconds(CLOCK_THREAD_CPUTIME_ID);
+}
+
+// Function to account a finished call
+void gl_instrument_end(int category, double start) {
+    gl_counters->calls[category]++;
+    gl_counters->time[category] += clock_seconds(CLOCK_THREAD_CPUTIME_ID) - start;
+}
+
+// Function to count bytes handed to the driver for upload
+void gl_instrument_upload(size_t bytes) {
+    if (gl_counters) {
+        gl_counters->upload_bytes += bytes;
+    }
+}
@@ -0,0 +1,50 @@
+/**
+ * Optional per-frame instrumentation of GL calls.
+ *
+ * Calls wrapped in GL_INSTRUMENT() are counted per category, together with
+ * the thread CPU time spent inside them (i.e. in the driver), while the
+ * calling thread has counters installed with gl_instrument_attach(). Without
+ * counters the wrapper costs one thread-local load and branch.
+ */
+
+#ifndef GL_INSTRUMENT_H
+#define GL_INSTRUMENT_H
+
+#include <stddef.h>
+
+enum {
+    GL_CATEGORY_STATE,   // State changes, matrix operations
+    GL_CATEGORY_DRAW,    // Clears, draws, display list calls
+    GL_CATEGORY_UPLOAD,  // Buffer data and display list compilation
+    GL_CATEGORY_SWAP,    // Swaps and presentation feedback
+    GL_CATEGORIES
+};
+
+extern const char *const gl_category_names[GL_CATEGORIES];
+
+typedef struct {
+    unsigned long calls[GL_CATEGORIES];
+    double time[GL_CATEGORIES];     // Thread CPU seconds inside the calls
+    unsigned long upload_bytes;
+} GlCounters;
+
+extern _Thread_local GlCounters *gl_counters;
+
+void gl_instrument_attach(GlCounters *counters);
+double gl_instrument_begin(void);
+void gl_instrument_end(int category, double start);
+void gl_instrument_upload(size_t bytes);
+
+// Runs `call`, accounting it to `category` when instrumenting
+#define GL_INSTRUMENT(category, call)                       \
+    do {                                                    \
+        if (gl_counters) {                                  \
+            double gl_instrument_start = gl_instrument_begin(); \
+            call;                                           \
+            gl_instrument_end(category, gl_instrument_start); \
+        } else {                                            \
+            call;                                           \
+        }                                                   \
+    } while (0)
+
+#endif
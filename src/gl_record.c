@@ -0,0 +1,90 @@
+/**
+ * Recording of the GL command stream, see gl_record.h.
+ */
+
+#include <string.h>
+
+#include "gl_record.h"
+
+_Thread_local GlRecorder *gl_recorder;
+
+// Function to create the recording and attach it to the calling thread.
+// The header is completed when the recording is closed.
+int gl_record_open(GlRecorder *recorder, const char *path, unsigned long frames) {
+    memset(recorder, 0, sizeof(*recorder));
+    recorder->path = path;
+    recorder->max_frames = frames;
+    recorder->file = fopen(path, "wb");
+    if (!recorder->file) {
+        perror(path);
+        return -1;
+    }
+    RecordHeader header = {.magic = RECORD_MAGIC, .version = RECORD_VERSION};
+    fwrite(&header, sizeof(header), 1, recorder->file);
+    gl_recorder = recorder;
+    return 0;
+}
+
+// Function to append a call with its arguments and payload
+void gl_record_call(int op, const uint32_t *words, int count, const void *payload, size_t size) {
+    static const char padding[4];
+    GlRecorder *recorder = gl_recorder;
+    RecordCall call = {.op = op, .words = count, .payload = size};
+    fwrite(&call, sizeof(call), 1, recorder->file);
+    if (count > 0) {
+        fwrite(words, sizeof(*words), count, recorder->file);
+    }
+    if (size > 0) {
+        fwrite(payload, 1, size, recorder->file);
+        fwrite(padding, 1, (4 - size % 4) % 4, recorder->file);
+    }
+    recorder->bytes += sizeof(call) + count * sizeof(*words) + (size + 3) / 4 * 4;
+}
+
+// Function to append a call with float arguments
+void gl_record_floats(int op, const float *values, int count) {
+    uint32_t words[16];
+    memcpy(words, values, count * sizeof(*values));
+    gl_record_call(op, words, count, NULL, 0);
+}
+
+// Function to mark the start of a frame. The first one ends the setup
+// section.
+void gl_record_begin_frame(void) {
+    if (!gl_recorder->setup_done) {
+        gl_record_call(RECORD_SETUP_END, NULL, 0, NULL, 0);
+        gl_recorder->setup_done = 1;
+    }
+}
+
+// Function to mark the end of a frame, at the swap. Returns 1, with the
+// recording closed, after the last frame.
+int gl_record_frame(int width, int height) {
+    gl_record_call(RECORD_FRAME, NULL, 0, NULL, 0);
+    if (++gl_recorder->frames < gl_recorder->max_frames) {
+        return 0;
+    }
+    gl_record_close(width, height);
+    return 1;
+}
+
+// Function to complete the header, close the file and detach the recorder
+void gl_record_close(int width, int height) {
+    GlRecorder *recorder = gl_recorder;
+    RecordHeader header = {
+        .magic = RECORD_MAGIC,
+        .version = RECORD_VERSION,
+        .width = width,
+        .height = height,
+        .frames = recorder->frames,
+    };
+    int written = fseek(recorder->file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, recorder->file) == 1;
+    if (fclose(recorder->file) != 0 || !written) {
+        perror(recorder->path);
+    } else {
+        fprintf(stderr, "Recorded %lu frames of GL calls (%.1f KiB) to %s\n", recorder->frames,
+                recorder->bytes / 1024.0, recorder->path);
+    }
+    recorder->file = NULL;
+    gl_recorder = NULL;
+}
@@ -0,0 +1,104 @@
+/**
+ * Recording of the GL command stream, for replay with tools/gl_replay.c.
+ *
+ * While a recorder is attached to the render thread, the GL calls of the
+ * fixed-function paths are written to a file along with their buffer and
+ * client array payloads: first the setup (buffers, display lists, state),
+ * then the given number of frames. The file starts with a RecordHeader,
+ * followed by records of a RecordCall, its 32-bit arguments and its payload
+ * padded to 4 bytes. Object names are recorded as the driver returned them;
+ * the replayer maps them to its own.
+ */
+
+#ifndef GL_RECORD_H
+#define GL_RECORD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define RECORD_MAGIC "DCGLREC"
+#define RECORD_VERSION 1
+
+enum {
+    RECORD_SETUP_END = 1,       // Frames follow
+    RECORD_FRAME,               // Swap, end of a frame
+    RECORD_CLEAR,               // mask
+    RECORD_CLEAR_COLOR,         // 4 floats
+    RECORD_ENABLE,              // capability
+    RECORD_DISABLE,             // capability
+    RECORD_ENABLE_CLIENT_STATE, // array
+    RECORD_VIEWPORT,            // x, y, width, height
+    RECORD_SCISSOR,             // x, y, width, height
+    RECORD_MATRIX_MODE,         // mode
+    RECORD_LOAD_MATRIX,         // 16 floats
+    RECORD_ROTATE,              // 4 floats
+    RECORD_GEN_BUFFER,          // name
+    RECORD_BIND_BUFFER,         // target, name
+    RECORD_BUFFER_DATA,         // target, usage; data
+    RECORD_BUFFER_SUB_DATA,     // target, offset; data
+    RECORD_VERTEX_POINTER,      // size, type, stride, offset; client array if any
+    RECORD_COLOR_POINTER,       // size, type, stride, offset; client array if any
+    RECORD_DRAW_ELEMENTS,       // mode, count, type, offset; client indices if any
+    RECORD_GEN_LISTS,           // first name, count
+    RECORD_DELETE_LISTS,        // first name, count
+    RECORD_NEW_LIST,            // name
+    RECORD_END_LIST,
+    RECORD_CALL_LIST,           // name
+    RECORD_OPS
+};
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t width;             // Of the recorded window
+    uint32_t height;
+    uint32_t frames;
+} RecordHeader;
+
+typedef struct {
+    uint16_t op;
+    uint16_t words;             // 32-bit arguments following
+    uint32_t payload;           // Payload bytes after the arguments
+} RecordCall;
+
+typedef struct {
+    FILE *file;
+    const char *path;
+    unsigned long frames;
+    unsigned long max_frames;
+    int setup_done;             // Setup section ended
+    unsigned long bytes;
+} GlRecorder;
+
+// Recorder attached to the calling thread, NULL unless recording
+extern _Thread_local GlRecorder *gl_recorder;
+
+int gl_record_open(GlRecorder *recorder, const char *path, unsigned long frames);
+void gl_record_call(int op, const uint32_t *words, int count, const void *payload, size_t size);
+void gl_record_floats(int op, const float *values, int count);
+void gl_record_begin_frame(void);
+int gl_record_frame(int width, int height);
+void gl_record_close(int width, int height);
+
+// Records a call with integer (or enum, or name) arguments when recording
+#define GL_RECORD(op, ...)                                                  \
+    do {                                                                    \
+        if (gl_recorder) {                                                  \
+            const uint32_t gl_record_words[] = {__VA_ARGS__};               \
+            gl_record_call(op, gl_record_words,                             \
+                           sizeof(gl_record_words) / sizeof(uint32_t), NULL, 0); \
+        }                                                                   \
+    } while (0)
+
+// Records a call with float arguments when recording
+#define GL_RECORD_FLOATS(op, ...)                                           \
+    do {                                                                    \
+        if (gl_recorder) {                                                  \
+            const float gl_record_values[] = {__VA_ARGS__};                 \
+            gl_record_floats(op, gl_record_values,                          \
+                             sizeof(gl_record_values) / sizeof(float));     \
+        }                                                                   \
+    } while (0)
+
+#endif
@@ -0,0 +1,158 @@
+/**
+ * GL state tracking, see gl_state.h.
+ */
+
+#include <string.h>
+
+#include "gl_instrument.h"
+#include "gl_record.h"
+#include "gl_state.h"
+
+// Capabilities tracked by gl_state_enable(), by bit
+static const GLenum tracked_capabilities[] = {
+    GL_DEPTH_TEST,
+    GL_MULTISAMPLE,
+    GL_SCISSOR_TEST,
+};
+
+// Function to forget all tracked state, e.g. for a new context
+void gl_state_reset(GlState *state) {
+    int bypass = state->bypass;
+    unsigned long issued = state->issued;
+    unsigned long filtered = state->filtered;
+    memset(state, 0, sizeof(*state));
+    state->bypass = bypass;
+    state->issued = issued;
+    state->filtered = filtered;
+    gl_state_invalidate_view(state);
+    state->scissor[2] = -1;
+    state->array_buffer = ~0u;
+    state->element_buffer = ~0u;
+    state->program = ~0u;
+    state->clear_color[0] = -1.0f;
+}
+
+// Function to forget the matrix mode, viewport and projection, after
+// calling a display list that sets them
+void gl_state_invalidate_view(GlState *state) {
+    state->matrix_mode = 0;
+    state->viewport[2] = -1;
+    state->projection_aspect = 0.0f;
+}
+
+// Function to start compiling a display list. Calls until
+// gl_state_end_list() go into the list and are neither filtered nor tracked.
+void gl_state_begin_list(GlState *state, GLuint list) {
+    GL_INSTRUMENT(GL_CATEGORY_UPLOAD, glNewList(list, GL_COMPILE));
+    GL_RECORD(RECORD_NEW_LIST, list);
+    state->compiling = 1;
+}
+
+// Function to finish compiling a display list
+void gl_state_end_list(GlState *state) {
+    GL_INSTRUMENT(GL_CATEGORY_UPLOAD, glEndList());
+    if (gl_recorder) gl_record_call(RECORD_END_LIST, NULL, 0, NULL, 0);
+    state->compiling = 0;
+}
+
+// Function to count a call that is issued or filtered. Returns 1 if the call
+// must be issued.
+static int track(GlState *state, int changed) {
+    if (state->compiling) {
+        return 1;
+    }
+    if (changed || state->bypass) {
+        state->issued++;
+    } else {
+        state->filtered++;
+    }
+    return changed;
+}
+
+void gl_state_matrix_mode(GlState *state, GLenum mode) {
+    if (track(state, state->matrix_mode != mode)) {
+        GL_INSTRUMENT(GL_CATEGORY_STATE, glMatrixMode(mode));
+        GL_RECORD(RECORD_MATRIX_MODE, mode);
+        if (!state->compiling) state->matrix_mode = mode;
+    }
+}
+
+void gl_state_viewport(GlState *state, GLint x, GLint y, GLsizei width, GLsizei height) {
+    GLint viewport[4] = {x, y, width, height};
+    if (track(state, memcmp(state->viewport, viewport, sizeof(viewport)) != 0)) {
+        GL_INSTRUMENT(GL_CATEGORY_STATE, glViewport(x, y, width, height));
+        GL_RECORD(RECORD_VIEWPORT, x, y, width, height);
+        if (!state->compiling) memcpy(state->viewport, viewport, sizeof(viewport));
+    }
+}
+
+void gl_state_scissor(GlState *state, GLint x, GLint y, GLsizei width, GLsizei height) {
+    GLint scissor[4] = {x, y, width, height};
+    if (track(state, memcmp(state->scissor, scissor, sizeof(scissor)) != 0)) {
+        GL_INSTRUMENT(GL_CATEGORY_STATE, glScissor(x, y, width, height));
+        GL_RECORD(RECORD_SCISSOR, x, y, width, height);
+        if (!state->compiling) memcpy(state->scissor, scissor, sizeof(scissor));
+    }
+}
+
+// Function to check whether the projection for the given aspect ratio must
+// be loaded. The caller loads it with one glLoadMatrixf if so, which counts
+// as issued; otherwise it counts as filtered. The matrix mode switch before
+// it is tracked on its own.
+int gl_state_need_projection(GlState *state, float aspect) {
+    if (state->compiling) {
+        return 1;
+    }
+    if (!track(state, state->projection_aspect != aspect || state->bypass)) {
+        return 0;
+    }
+    state->projection_aspect = aspect;
+    return 1;
+}
+
+void gl_state_enable(GlState *state, GLenum capability, int enabled) {
+    unsigned int bit = 0;
+    for (unsigned int i = 0; i < sizeof(tracked_capabilities) / sizeof(tracked_capabilities[0]); i++) {
+        if (tracked_capabilities[i] == capability) {
+            bit = 1u << i;
+        }
+    }
+    int changed = !bit || !(state->known & bit) || !(state->enabled & bit) != !enabled;
+    if (track(state, changed)) {
+        if (enabled) {
+            GL_INSTRUMENT(GL_CATEGORY_STATE, glEnable(capability));
+            GL_RECORD(RECORD_ENABLE, capability);
+        } else {
+            GL_INSTRUMENT(GL_CATEGORY_STATE, glDisable(capability));
+            GL_RECORD(RECORD_DISABLE, capability);
+        }
+        if (!state->compiling) {
+            state->known |= bit;
+            state->enabled = enabled ? state->enabled | bit : state->enabled & ~bit;
+        }
+    }
+}
+
+void gl_state_bind_buffer(GlState *state, GLenum target, GLuint buffer) {
+    GLuint *bound = target == GL_ELEMENT_ARRAY_BUFFER ? &state->element_buffer : &state->array_buffer;
+    if (track(state, *bound != buffer)) {
+        GL_INSTRUMENT(GL_CATEGORY_STATE, glBindBuffer(target, buffer));
+        GL_RECORD(RECORD_BIND_BUFFER, target, buffer);
+        if (!state->compiling) *bound = buffer;
+    }
+}
+
+void gl_state_use_program(GlState *state, GLuint program) {
+    if (track(state, state->program != program)) {
+        GL_INSTRUMENT(GL_CATEGORY_STATE, glUseProgram(program));
+        if (!state->compiling) state->program = program;
+    }
+}
+
+void gl_state_clear_color(GlState *state, const GLfloat color[4]) {
+    if (track(state, memcmp(state->clear_color, color, sizeof(state->clear_color)) != 0)) {
+        GL_INSTRUMENT(GL_CATEGORY_STATE, glClearColor(color[0], color[1], color[2], color[3]));
+        GL_RECORD_FLOATS(RECORD_CLEAR_COLOR, color[0], color[1], color[2], color[3]);
+        if (!state->compiling) memcpy(state->clear_color, color, sizeof(state->clear_color));
+    }
+}
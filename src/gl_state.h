@@ -0,0 +1,52 @@
+/**
+ * GL state tracking.
+ *
+ * Shadows the state the renderer sets so that calls which would not change
+ * anything are never issued. Every filtered call is one less trip into the
+ * driver, and with indirect GLX one less request on the wire. One GlState
+ * belongs to one context; it must be reset whenever a context is made
+ * current that the tracker has not seen all calls of.
+ *
+ * While a display list is being compiled calls are passed through without
+ * being tracked, and calling a list that changes tracked state must be
+ * followed by gl_state_invalidate_view().
+ */
+
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <GL/glew.h>
+
+typedef struct {
+    int bypass;                 // Issue every call, only count them
+    int compiling;              // Inside glNewList/glEndList
+    GLenum matrix_mode;         // 0 if unknown
+    GLint viewport[4];          // Width -1 if unknown
+    GLint scissor[4];
+    float projection_aspect;    // Aspect of the loaded projection, 0 if unknown
+    unsigned int enabled;       // Tracked capabilities, see gl_state.c
+    unsigned int known;
+    GLuint array_buffer;        // ~0 if unknown
+    GLuint element_buffer;
+    GLuint program;
+    GLfloat clear_color[4];     // Negative if unknown
+
+    // Calls issued and filtered since the counters were last taken
+    unsigned long issued;
+    unsigned long filtered;
+} GlState;
+
+void gl_state_reset(GlState *state);
+void gl_state_invalidate_view(GlState *state);
+void gl_state_begin_list(GlState *state, GLuint list);
+void gl_state_end_list(GlState *state);
+void gl_state_matrix_mode(GlState *state, GLenum mode);
+void gl_state_viewport(GlState *state, GLint x, GLint y, GLsizei width, GLsizei height);
+void gl_state_scissor(GlState *state, GLint x, GLint y, GLsizei width, GLsizei height);
+int gl_state_need_projection(GlState *state, float aspect);
+void gl_state_enable(GlState *state, GLenum capability, int enabled);
+void gl_state_bind_buffer(GlState *state, GLenum target, GLuint buffer);
+void gl_state_use_program(GlState *state, GLuint program);
+void gl_state_clear_color(GlState *state, const GLfloat color[4]);
+
+#endif
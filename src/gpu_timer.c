@@ -0,0 +1,61 @@
+/**
+ * GPU frame time from timer queries, see gpu_timer.h.
+ */
+
+#include <string.h>
+
+#include "gpu_timer.h"
+
+// Function to create the query objects in the current context. Returns -1
+// without timer queries.
+int gpu_timer_init(GpuTimer *timer) {
+    memset(timer, 0, sizeof(*timer));
+    if (!GLEW_ARB_timer_query && !GLEW_VERSION_3_3) {
+        return -1;
+    }
+    glGenQueries(GPU_TIMER_QUERIES, timer->queries);
+    timer->available = 1;
+    return 0;
+}
+
+// Function to start timing a frame, unless all queries are in flight
+void gpu_timer_begin(GpuTimer *timer) {
+    if (!timer->available || timer->issued - timer->collected == GPU_TIMER_QUERIES) {
+        return;
+    }
+    glBeginQuery(GL_TIME_ELAPSED, timer->queries[timer->issued % GPU_TIMER_QUERIES]);
+    timer->running = 1;
+}
+
+// Function to stop timing the frame
+void gpu_timer_end(GpuTimer *timer) {
+    if (timer->running) {
+        glEndQuery(GL_TIME_ELAPSED);
+        timer->issued++;
+        timer->running = 0;
+    }
+}
+
+// Function to add the results that are available, in ms, oldest first
+void gpu_timer_collect(GpuTimer *timer, SampleSeries *series) {
+    while (timer->collected < timer->issued) {
+        GLuint query = timer->queries[timer->collected % GPU_TIMER_QUERIES];
+        GLint ready = 0;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &ready);
+        if (!ready) {
+            break;
+        }
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+        series_add(series, nanoseconds / 1e6);
+        timer->collected++;
+    }
+}
+
+// Function to delete the query objects
+void gpu_timer_destroy(GpuTimer *timer) {
+    if (timer->available) {
+        glDeleteQueries(GPU_TIMER_QUERIES, timer->queries);
+    }
+    timer->available = 0;
+}
@@ -0,0 +1,33 @@
+/**
+ * GPU frame time from timer queries (GL_ARB_timer_query).
+ *
+ * Each frame's commands are bracketed by a GL_TIME_ELAPSED query. Results
+ * are collected a few frames later, once available, from a small ring of
+ * query objects, so reading them never stalls the pipeline. Frames are
+ * skipped when every query is still in flight.
+ */
+
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <GL/glew.h>
+
+#include "frame_stats.h"
+
+#define GPU_TIMER_QUERIES 4
+
+typedef struct {
+    int available;
+    GLuint queries[GPU_TIMER_QUERIES];
+    unsigned long issued;       // Queries begun, ring position of the next
+    unsigned long collected;    // Queries read back
+    int running;
+} GpuTimer;
+
+int gpu_timer_init(GpuTimer *timer);
+void gpu_timer_begin(GpuTimer *timer);
+void gpu_timer_end(GpuTimer *timer);
+void gpu_timer_collect(GpuTimer *timer, SampleSeries *series);
+void gpu_timer_destroy(GpuTimer *timer);
+
+#endif
@@ -0,0 +1,67 @@
+/**
+ * Screensaver and DPMS state tracking, see idle.h.
+ */
+
+#include <X11/Xlib.h>
+#include <X11/extensions/dpms.h>
+#include <X11/extensions/scrnsaver.h>
+
+#include "idle.h"
+
+// Function to query the extensions and subscribe to screensaver events
+int idle_monitor_init(IdleMonitor *monitor, Display *display, Window root) {
+    int error_base;
+    monitor->saver_active = 0;
+    monitor->dpms_off = 0;
+
+    monitor->has_saver = XScreenSaverQueryExtension(display, &monitor->saver_event_base, &error_base);
+    if (monitor->has_saver) {
+        XScreenSaverSelectInput(display, root, ScreenSaverNotifyMask);
+
+        // Pick up the current state, the saver may already be running
+        XScreenSaverInfo *info = XScreenSaverAllocInfo();
+        if (info) {
+            if (XScreenSaverQueryInfo(display, root, info)) {
+                monitor->saver_active = info->state == ScreenSaverOn;
+            }
+            XFree(info);
+        }
+    }
+
+    int dpms_event_base;
+    monitor->has_dpms = DPMSQueryExtension(display, &dpms_event_base, &error_base) && DPMSCapable(display);
+    idle_monitor_poll(monitor, display);
+    return 0;
+}
+
+// Function to update state from an X event. Returns 1 if the state changed.
+int idle_monitor_handle_event(IdleMonitor *monitor, const XEvent *event) {
+    if (!monitor->has_saver || event->type != monitor->saver_event_base + ScreenSaverNotify) {
+        return 0;
+    }
+    const XScreenSaverNotifyEvent *notify = (const XScreenSaverNotifyEvent *)event;
+    int active = notify->state == ScreenSaverOn;
+    if (active == monitor->saver_active) {
+        return 0;
+    }
+    monitor->saver_active = active;
+    return 1;
+}
+
+// Function to poll the DPMS power level. Returns 1 if the state changed.
+int idle_monitor_poll(IdleMonitor *monitor, Display *display) {
+    if (!monitor->has_dpms) {
+        return 0;
+    }
+    CARD16 power_level;
+    BOOL enabled;
+    if (!DPMSInfo(display, &power_level, &enabled)) {
+        return 0;
+    }
+    int off = enabled && power_level != DPMSModeOn;
+    if (off == monitor->dpms_off) {
+        return 0;
+    }
+    monitor->dpms_off = off;
+    return 1;
+}
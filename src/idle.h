@@ -0,0 +1,26 @@
+/**
+ * Screensaver and DPMS state tracking.
+ *
+ * Uses MIT-SCREEN-SAVER notify events where available and polls DPMS power
+ * level (which has no events) from a slow timer.
+ */
+
+#ifndef IDLE_H
+#define IDLE_H
+
+#include <X11/Xlib.h>
+
+typedef struct {
+    int has_saver;
+    int saver_event_base;
+    int has_dpms;
+
+    int saver_active;
+    int dpms_off;
+} IdleMonitor;
+
+int idle_monitor_init(IdleMonitor *monitor, Display *display, Window root);
+int idle_monitor_handle_event(IdleMonitor *monitor, const XEvent *event);
+int idle_monitor_poll(IdleMonitor *monitor, Display *display);
+
+#endif
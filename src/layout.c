@@ -0,0 +1,17 @@
+/**
+ * Desktop window size from the monitor layout, see layout.h.
+ */
+
+#include "layout.h"
+
+// Function to calculate the combined width and height of all monitors
+void layout_bounds(const XineramaScreenInfo *monitors, int count, int *width, int *height) {
+    int combined_width = 0;
+    int combined_height = 0;
+    for (int i = 0; i < count; i++) {
+        combined_width += monitors[i].width;
+        combined_height += (monitors[i].height > combined_height) ? monitors[i].height : 0;
+    }
+    *width = combined_width;
+    *height = combined_height;
+}
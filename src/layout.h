@@ -0,0 +1,13 @@
+/**
+ * Desktop window size from the monitor layout.
+ */
+
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <X11/Xlib.h>
+#include <X11/extensions/Xinerama.h>
+
+void layout_bounds(const XineramaScreenInfo *monitors, int count, int *width, int *height);
+
+#endif
@@ -0,0 +1,221 @@
+/**
+ * Performance counters of the render thread, see perf_counters.h.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+#include "perf_counters.h"
+
+static const struct {
+    const char *name;
+    const char *key;    // JSON member prefix
+    uint32_t type;
+    uint64_t config;
+} perf_events[PERF_COUNTERS] = {
+    [PERF_CYCLES] = {"cycles", "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    [PERF_INSTRUCTIONS] = {"instructions", "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    [PERF_CACHE_MISSES] = {"cache misses", "cache_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    [PERF_BRANCH_MISSES] = {"branch misses", "branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    [PERF_CONTEXT_SWITCHES] = {"context switches", "context_switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+    [PERF_PAGE_FAULTS] = {"page faults", "page_faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+};
+
+// Layout of a PERF_FORMAT_GROUP read with the enabled and running times
+typedef struct {
+    uint64_t count;
+    uint64_t enabled;
+    uint64_t running;
+    uint64_t values[PERF_COUNTERS];
+} GroupRead;
+
+// Function to open one counter of the calling thread
+static int open_event(int index, int group_fd, int user_only) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = perf_events[index].type;
+    attr.config = perf_events[index].config;
+    attr.exclude_kernel = user_only;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, PERF_FLAG_FD_CLOEXEC);
+}
+
+// Function to read the kernel's perf_event_paranoid level, -1 if unknown
+static int paranoid_level(void) {
+    FILE *file = fopen("/proc/sys/kernel/perf_event_paranoid", "r");
+    int level = -1;
+    if (file) {
+        if (fscanf(file, "%d", &level) != 1) level = -1;
+        fclose(file);
+    }
+    return level;
+}
+
+// Function to open the counters for the calling thread. Returns -1, with
+// a note on why, if none could be opened.
+int perf_counters_open(PerfCounters *counters) {
+    memset(counters, 0, sizeof(*counters));
+    counters->leader = -1;
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+        counters->fds[i] = -1;
+    }
+
+    // Counting kernel time (where much of the driver work happens) needs
+    // perf_event_paranoid below 2 or CAP_PERFMON, otherwise fall back to
+    // user space only
+    int denied = 0;
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+        int fd = open_event(i, counters->leader, counters->user_only);
+        if (fd < 0 && (errno == EACCES || errno == EPERM) && !counters->user_only) {
+            counters->user_only = 1;
+            fd = open_event(i, counters->leader, 1);
+        }
+        if (fd < 0) {
+            denied |= errno == EACCES || errno == EPERM;
+            continue;
+        }
+        if (counters->leader < 0) {
+            counters->leader = fd;
+        }
+        counters->fds[i] = fd;
+        counters->slots[i] = counters->num_open++;
+    }
+
+    if (counters->leader < 0) {
+        if (denied) {
+            fprintf(stderr, "Performance counters not permitted (perf_event_paranoid is %d), "
+                    "set it to 2 or lower or grant CAP_PERFMON\n", paranoid_level());
+        } else {
+            fprintf(stderr, "Performance counters not supported: %s\n", strerror(errno));
+        }
+        return -1;
+    }
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+        if (counters->fds[i] < 0) {
+            fprintf(stderr, "Performance counter %s not available\n", perf_events[i].name);
+        }
+    }
+    if (counters->user_only) {
+        fprintf(stderr, "Performance counters exclude kernel time (perf_event_paranoid)\n");
+    }
+    return 0;
+}
+
+// Function to read the whole group. Returns -1 on failure.
+static int read_group(const PerfCounters *counters, GroupRead *values) {
+    ssize_t size = (3 + counters->num_open) * sizeof(uint64_t);
+    return read(counters->leader, values, size) == size ? 0 : -1;
+}
+
+// Function to sample the counters at the start of a frame
+void perf_counters_begin(PerfCounters *counters) {
+    GroupRead values;
+    if (counters->leader < 0 || read_group(counters, &values) != 0) {
+        return;
+    }
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+        if (counters->fds[i] >= 0) {
+            counters->start[i] = values.values[counters->slots[i]];
+        }
+    }
+    counters->enabled -= values.enabled;
+    counters->running -= values.running;
+}
+
+// Function to sample the counters at the end of a frame and record the
+// differences
+void perf_counters_end(PerfCounters *counters) {
+    GroupRead values;
+    if (counters->leader < 0 || read_group(counters, &values) != 0) {
+        return;
+    }
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+        if (counters->fds[i] >= 0) {
+            series_add(&counters->per_frame[i], values.values[counters->slots[i]] - counters->start[i]);
+        }
+    }
+    counters->enabled += values.enabled;
+    counters->running += values.running;
+    counters->frames++;
+}
+
+// Function to drop the samples taken so far, keeping the counters open
+void perf_counters_reset(PerfCounters *counters) {
+    memset(counters->per_frame, 0, sizeof(counters->per_frame));
+    counters->enabled = 0;
+    counters->running = 0;
+    counters->frames = 0;
+}
+
+// Function to print per-frame counter percentiles
+void perf_counters_print(FILE *stream, const PerfCounters *counters) {
+    if (counters->leader < 0 || counters->frames == 0) {
+        return;
+    }
+    fprintf(stream, "performance counters per frame%s:\n", counters->user_only ? " (user space only)" : "");
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+        if (counters->fds[i] < 0) {
+            continue;
+        }
+        SeriesSummary summary;
+        series_summarize(&counters->per_frame[i], &summary);
+        fprintf(stream, "  %-16s mean %.1f, p50 %.0f, p90 %.0f, p99 %.0f, max %.0f\n", perf_events[i].name,
+                summary.mean, summary.p50, summary.p90, summary.p99, summary.max);
+    }
+    if (counters->fds[PERF_CYCLES] >= 0 && counters->fds[PERF_INSTRUCTIONS] >= 0) {
+        SeriesSummary cycles, instructions;
+        series_summarize(&counters->per_frame[PERF_CYCLES], &cycles);
+        series_summarize(&counters->per_frame[PERF_INSTRUCTIONS], &instructions);
+        if (cycles.mean > 0) {
+            fprintf(stream, "  instructions per cycle: %.2f\n", instructions.mean / cycles.mean);
+        }
+    }
+    // A group that did not fit on the PMU is time-multiplexed and only
+    // counts part of each frame
+    if (counters->enabled > 0 && counters->running < counters->enabled) {
+        fprintf(stream, "  counters ran %.0f%% of the time (multiplexed)\n",
+                100.0 * counters->running / counters->enabled);
+    }
+}
+
+// Function to print the mean of each counter per frame and the instructions
+// per cycle as flat JSON members, with nulls for counters that are not open
+void perf_counters_print_json(FILE *stream, const PerfCounters *counters) {
+    int open = counters->leader >= 0 && counters->frames > 0;
+    double means[PERF_COUNTERS];
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+        SeriesSummary summary;
+        if (open && counters->fds[i] >= 0) {
+            series_summarize(&counters->per_frame[i], &summary);
+            means[i] = summary.mean;
+            fprintf(stream, ",\"%s_per_frame\":%.1f", perf_events[i].key, means[i]);
+        } else {
+            means[i] = 0;
+            fprintf(stream, ",\"%s_per_frame\":null", perf_events[i].key);
+        }
+    }
+    if (means[PERF_CYCLES] > 0 && counters->fds[PERF_INSTRUCTIONS] >= 0) {
+        fprintf(stream, ",\"ipc\":%.3f", means[PERF_INSTRUCTIONS] / means[PERF_CYCLES]);
+    } else {
+        fprintf(stream, ",\"ipc\":null");
+    }
+}
+
+// Function to close the counters
+void perf_counters_close(PerfCounters *counters) {
+    if (counters->leader < 0) {
+        return;
+    }
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+        if (counters->fds[i] >= 0) close(counters->fds[i]);
+        counters->fds[i] = -1;
+    }
+    counters->leader = -1;
+}
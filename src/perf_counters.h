@@ -0,0 +1,50 @@
+/**
+ * Hardware and software performance counters of the render thread.
+ *
+ * Opened with perf_event_open() as one group, so all counters run together
+ * and one read() samples them at once. Counters the CPU or kernel does not
+ * support (e.g. hardware events in most VMs) are left out. With
+ * perf_event_paranoid at 2, only user space is counted; above that, perf
+ * events are unavailable to unprivileged processes and the mode is off.
+ */
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "frame_stats.h"
+
+enum {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_CACHE_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_CONTEXT_SWITCHES,
+    PERF_PAGE_FAULTS,
+    PERF_COUNTERS
+};
+
+typedef struct {
+    int leader;                 // Group leader fd, -1 if nothing could be opened
+    int fds[PERF_COUNTERS];     // -1 for counters left out
+    int slots[PERF_COUNTERS];   // Position of each counter in a group read
+    int num_open;
+    int user_only;              // Kernel time is excluded
+    uint64_t start[PERF_COUNTERS];
+    uint64_t enabled;           // Time the group was enabled and running,
+    uint64_t running;           // below 100% when multiplexed
+    unsigned long frames;
+    SampleSeries per_frame[PERF_COUNTERS];
+} PerfCounters;
+
+int perf_counters_open(PerfCounters *counters);
+void perf_counters_begin(PerfCounters *counters);
+void perf_counters_end(PerfCounters *counters);
+void perf_counters_reset(PerfCounters *counters);
+void perf_counters_print(FILE *stream, const PerfCounters *counters);
+void perf_counters_print_json(FILE *stream, const PerfCounters *counters);
+void perf_counters_close(PerfCounters *counters);
+
+#endif
@@ -0,0 +1,151 @@
+/**
+ * Presentation timing feedback, see present.h.
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+
+#include <GL/glx.h>
+
+#include "present.h"
+
+typedef Bool (*GetSyncValuesProc)(Display *, GLXDrawable, int64_t *, int64_t *, int64_t *);
+typedef Bool (*GetMscRateProc)(Display *, GLXDrawable, int32_t *, int32_t *);
+typedef int64_t (*SwapBuffersMscProc)(Display *, GLXDrawable, int64_t, int64_t, int64_t);
+typedef Bool (*WaitForSbcProc)(Display *, GLXDrawable, int64_t, int64_t *, int64_t *, int64_t *);
+
+static GetSyncValuesProc get_sync_values;
+static GetMscRateProc get_msc_rate;
+static SwapBuffersMscProc swap_buffers_msc;
+static WaitForSbcProc wait_for_sbc;
+
+// Entry points are process-wide, while every renderer thread initializes
+// its own timing
+static pthread_once_t entry_points_once = PTHREAD_ONCE_INIT;
+
+// Function to load the OML entry points, once
+static void load_entry_points(void) {
+    get_sync_values = (GetSyncValuesProc)glXGetProcAddressARB((const GLubyte *)"glXGetSyncValuesOML");
+    get_msc_rate = (GetMscRateProc)glXGetProcAddressARB((const GLubyte *)"glXGetMscRateOML");
+    swap_buffers_msc = (SwapBuffersMscProc)glXGetProcAddressARB((const GLubyte *)"glXSwapBuffersMscOML");
+    wait_for_sbc = (WaitForSbcProc)glXGetProcAddressARB((const GLubyte *)"glXWaitForSbcOML");
+}
+
+// Function to check for a GLX extension on a screen
+int has_glx_extension(Display *display, int screen, const char *name) {
+    const char *extensions = glXQueryExtensionsString(display, screen);
+    size_t length = strlen(name);
+    for (const char *p = extensions; p && (p = strstr(p, name)); p += length) {
+        if ((p == extensions || p[-1] == ' ') && (p[length] == ' ' || p[length] == '\0')) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Function to load the OML entry points and read the initial counters
+int present_init(PresentTiming *timing, Display *display, int screen, GLXDrawable drawable) {
+    memset(timing, 0, sizeof(*timing));
+    timing->swap_interval = 1;
+    if (!has_glx_extension(display, screen, "GLX_OML_sync_control")) {
+        return -1;
+    }
+
+    pthread_once(&entry_points_once, load_entry_points);
+    if (!get_sync_values || !get_msc_rate || !swap_buffers_msc || !wait_for_sbc) {
+        return -1;
+    }
+
+    int64_t ust, msc, sbc;
+    if (!get_sync_values(display, drawable, &ust, &msc, &sbc)) {
+        return -1;
+    }
+    timing->next_sbc = sbc + 1;
+    timing->last_msc = msc;
+
+    int32_t numerator, denominator;
+    if (get_msc_rate(display, drawable, &numerator, &denominator) && denominator > 0) {
+        timing->refresh_rate = (double)numerator / denominator;
+    }
+    timing->available = 1;
+    return 0;
+}
+
+// Function to derive the number of vblanks per frame for scheduled swaps
+void present_set_target_fps(PresentTiming *timing, int target_fps) {
+    timing->swap_interval = 1;
+    if (timing->refresh_rate > 0 && target_fps > 0) {
+        int interval = (int)lround(timing->refresh_rate / target_fps);
+        timing->swap_interval = interval > 1 ? interval : 1;
+    }
+}
+
+// Function to start a new interval series, e.g. after a pause, so the time
+// spent paused is not reported as a presentation interval
+void present_restart(PresentTiming *timing) {
+    timing->last_ust = 0;
+}
+
+// Function to predict when a frame submitted after `latency` seconds of
+// rendering from `now` will be presented. Uses the last presentation time
+// and refresh period when available, otherwise assumes the frame lands one
+// frame interval after submission.
+double present_predict(const PresentTiming *timing, double now, double latency, double frame_interval) {
+    double submit = now + latency;
+    if (timing->available && timing->last_ust != 0 && timing->refresh_rate > 0) {
+        double period = 1.0 / timing->refresh_rate;
+        double last = timing->last_ust / 1e6;
+
+        // UST is CLOCK_MONOTONIC in microseconds on Mesa; ignore it if the
+        // driver uses some other time base
+        if (fabs(now - last) < 1.0) {
+            double vblanks = ceil((submit - last) / period);
+            if (vblanks < timing->swap_interval) {
+                vblanks = timing->swap_interval;
+            }
+            return last + vblanks * period;
+        }
+    }
+    return submit + frame_interval;
+}
+
+// Function to swap buffers, at the next target MSC if scheduling is enabled
+void present_swap(PresentTiming *timing, Display *display, GLXDrawable drawable) {
+    if (!timing->available) {
+        glXSwapBuffers(display, drawable);
+        return;
+    }
+    if (timing->schedule) {
+        int64_t sbc = swap_buffers_msc(display, drawable, timing->last_msc + timing->swap_interval, 0, 0);
+        if (sbc > 0) {
+            timing->next_sbc = sbc;
+        }
+    } else {
+        glXSwapBuffers(display, drawable);
+    }
+    timing->pending_sbc = timing->next_sbc++;
+}
+
+// Function to read back when the previous swap was presented. Called one
+// frame later, so the swap has normally completed and this does not block.
+// Returns 1 if a sample was produced.
+int present_collect(PresentTiming *timing, Display *display, GLXDrawable drawable, PresentSample *sample) {
+    if (!timing->available || timing->pending_sbc == 0) {
+        return 0;
+    }
+    int64_t ust, msc, sbc;
+    int64_t target = timing->pending_sbc;
+    timing->pending_sbc = 0;
+    if (!wait_for_sbc(display, drawable, target, &ust, &msc, &sbc)) {
+        return 0;
+    }
+
+    int have_previous = timing->last_ust != 0;
+    sample->present_time = ust / 1e6;
+    sample->interval_ms = (ust - timing->last_ust) / 1000.0;
+    sample->msc_delta = msc - timing->last_msc;
+    timing->last_ust = ust;
+    timing->last_msc = msc;
+    return have_previous;
+}
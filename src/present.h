@@ -0,0 +1,42 @@
+/**
+ * Presentation timing feedback via GLX_OML_sync_control.
+ *
+ * Each swap is tagged with its swap buffer count (SBC); on the next frame the
+ * UST/MSC at which that swap actually hit the display is read back, so frame
+ * intervals reflect what is on screen rather than CPU submission time.
+ */
+
+#ifndef PRESENT_H
+#define PRESENT_H
+
+#include <stdint.h>
+
+#include <GL/glx.h>
+
+typedef struct {
+    int available;
+    double refresh_rate;      // Hz, 0 if unknown
+    int schedule;             // Swap at a target MSC instead of immediately
+    int swap_interval;        // Vblanks per frame when scheduling
+
+    int64_t next_sbc;         // SBC the next swap will get
+    int64_t pending_sbc;      // SBC of a swap not yet read back, 0 if none
+    int64_t last_ust;         // Microseconds
+    int64_t last_msc;
+} PresentTiming;
+
+typedef struct {
+    double present_time;      // Seconds, in the UST (CLOCK_MONOTONIC) domain
+    double interval_ms;       // Time since the previous presentation
+    int64_t msc_delta;        // Vblanks since the previous presentation
+} PresentSample;
+
+int has_glx_extension(Display *display, int screen, const char *name);
+int present_init(PresentTiming *timing, Display *display, int screen, GLXDrawable drawable);
+void present_set_target_fps(PresentTiming *timing, int target_fps);
+void present_restart(PresentTiming *timing);
+double present_predict(const PresentTiming *timing, double now, double latency, double frame_interval);
+void present_swap(PresentTiming *timing, Display *display, GLXDrawable drawable);
+int present_collect(PresentTiming *timing, Display *display, GLXDrawable drawable, PresentSample *sample);
+
+#endif
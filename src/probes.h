@@ -0,0 +1,30 @@
+/**
+ * USDT (statically defined tracing) probes.
+ *
+ * Built with <sys/sdt.h> (systemtap-sdt-dev / systemtap-sdt-devel) when the
+ * Makefile finds it. An unattached probe is a single nop; its location and
+ * argument operands live in an ELF note, so release builds keep them and
+ * tools can attach without a special build:
+ *
+ *     bpftrace -l 'usdt:/opt/cube/desktop_cube:*'
+ *
+ * All probes are in the `desktop_cube` provider. Without <sys/sdt.h> they
+ * compile to nothing.
+ */
+
+#ifndef PROBES_H
+#define PROBES_H
+
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+
+#define PROBE1(name, a) DTRACE_PROBE1(desktop_cube, name, a)
+#define PROBE2(name, a, b) DTRACE_PROBE2(desktop_cube, name, a, b)
+#define PROBE3(name, a, b, c) DTRACE_PROBE3(desktop_cube, name, a, b, c)
+#else
+#define PROBE1(name, a) do {} while (0)
+#define PROBE2(name, a, b) do {} while (0)
+#define PROBE3(name, a, b, c) do {} while (0)
+#endif
+
+#endif
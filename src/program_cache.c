@@ -0,0 +1,242 @@
+/**
+ * On-disk cache of linked GLSL program binaries, see program_cache.h.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/stat.h>
+
+#include "program_cache.h"
+#include "scheduler.h"
+#include "shader.h"
+
+#define CACHE_MAGIC 0x42504344u  // "DCPB"
+#define CACHE_VERSION 1
+
+// Header in front of every cached binary
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t format;        // Binary format reported by the driver
+    uint32_t length;
+    uint64_t source_hash;
+    double compile_time;    // Seconds the original compile and link took
+} CacheHeader;
+
+// Function to hash a string (FNV-1a), continuing from a previous hash. Start
+// with 0 for a fresh hash.
+uint64_t program_cache_hash(const char *text, uint64_t hash) {
+    if (hash == 0) {
+        hash = 0xcbf29ce484222325ull;
+    }
+    for (const unsigned char *p = (const unsigned char *)text; *p; p++) {
+        hash = (hash ^ *p) * 0x100000001b3ull;
+    }
+    // Separate consecutive strings, so "ab"+"c" and "a"+"bc" differ
+    return (hash ^ 0xff) * 0x100000001b3ull;
+}
+
+// Function to create a directory and its parent if missing
+static int make_directories(char *path) {
+    char *slash = strrchr(path, '/');
+    if (slash && slash != path) {
+        *slash = '\0';
+        mkdir(path, 0700);
+        *slash = '/';
+    }
+    return mkdir(path, 0700) == 0 || errno == EEXIST ? 0 : -1;
+}
+
+// Function to delete binaries left behind by other driver versions of this
+// device. Names are <device>-<version>-<sources>.bin, with 16 hex digits
+// each.
+static void remove_stale(ProgramCache *cache) {
+    char device[32], version[32];
+    snprintf(device, sizeof(device), "%016" PRIx64 "-", cache->device_hash);
+    snprintf(version, sizeof(version), "%016" PRIx64 "-", cache->version_hash);
+    DIR *directory = opendir(cache->directory);
+    if (!directory) {
+        return;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(directory))) {
+        const char *name = entry->d_name;
+        if (strlen(name) == 3 * 17 + 3 && strcmp(name + 3 * 17 - 1, ".bin") == 0 &&
+            strncmp(name, device, 17) == 0 && strncmp(name + 17, version, 17) != 0) {
+            char path[4096 + 256];
+            snprintf(path, sizeof(path), "%s/%s", cache->directory, entry->d_name);
+            unlink(path);
+        }
+    }
+    closedir(directory);
+}
+
+// Function to open the cache for the current context's driver. Returns -1
+// if program binaries are not supported or there is no cache directory; the
+// programs are then just compiled every time.
+int program_cache_open(ProgramCache *cache) {
+    memset(cache, 0, sizeof(*cache));
+    GLint formats = 0;
+    if (GLEW_ARB_get_program_binary) {
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    }
+    if (formats <= 0) {
+        return -1;
+    }
+
+    const char *cache_home = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    int length;
+    if (cache_home && cache_home[0] == '/') {
+        length = snprintf(cache->directory, sizeof(cache->directory), "%s/desktop_cube", cache_home);
+    } else if (home && home[0]) {
+        length = snprintf(cache->directory, sizeof(cache->directory), "%s/.cache/desktop_cube", home);
+    } else {
+        return -1;
+    }
+    if (length <= 0 || (size_t)length >= sizeof(cache->directory) || make_directories(cache->directory) != 0) {
+        return -1;
+    }
+
+    cache->device_hash = program_cache_hash((const char *)glGetString(GL_VENDOR), 0);
+    cache->device_hash = program_cache_hash((const char *)glGetString(GL_RENDERER), cache->device_hash);
+    cache->version_hash = program_cache_hash((const char *)glGetString(GL_VERSION), 0);
+    cache->available = 1;
+    remove_stale(cache);
+    return 0;
+}
+
+// Function to get the file name for a program
+static void cache_path(const ProgramCache *cache, uint64_t hash, char *path, size_t size) {
+    snprintf(path, size, "%s/%016" PRIx64 "-%016" PRIx64 "-%016" PRIx64 ".bin", cache->directory,
+             cache->device_hash, cache->version_hash, hash);
+}
+
+// Function to load a cached binary. Returns 0 if there is none, or the
+// driver rejects it (in which case the file is removed).
+static GLuint load_binary(ProgramCache *cache, uint64_t hash) {
+    char path[4096 + 64];
+    cache_path(cache, hash, path, sizeof(path));
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return 0;
+    }
+
+    CacheHeader header;
+    void *binary = NULL;
+    int valid = fread(&header, sizeof(header), 1, file) == 1 && header.magic == CACHE_MAGIC &&
+                header.version == CACHE_VERSION && header.source_hash == hash &&
+                header.length > 0 && header.length < (64u << 20) && (binary = malloc(header.length)) &&
+                fread(binary, header.length, 1, file) == 1;
+    fclose(file);
+
+    GLuint program = 0;
+    if (valid) {
+        program = glCreateProgram();
+        glProgramBinary(program, header.format, binary, header.length);
+        if (!shader_link_status(program)) {
+            glDeleteProgram(program);
+            program = 0;
+        }
+    }
+    free(binary);
+    if (!program) {
+        cache->rejected++;
+        unlink(path);
+        return 0;
+    }
+    cache->saved_time += header.compile_time;
+    return program;
+}
+
+// Function to store a program's binary, via a temporary file renamed into
+// place
+static void store_binary(ProgramCache *cache, uint64_t hash, GLuint program, double compile_time) {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+    void *binary = malloc(length);
+    if (!binary) {
+        return;
+    }
+    CacheHeader header = {
+        .magic = CACHE_MAGIC,
+        .version = CACHE_VERSION,
+        .source_hash = hash,
+        .compile_time = compile_time,
+    };
+    GLenum format;
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &format, binary);
+    header.format = format;
+    header.length = written;
+
+    char path[4096 + 64];
+    char temporary[4096 + 96];
+    cache_path(cache, hash, path, sizeof(path));
+    snprintf(temporary, sizeof(temporary), "%s.%d.%lx.tmp", path, (int)getpid(), (unsigned long)pthread_self());
+    FILE *file = written > 0 ? fopen(temporary, "wb") : NULL;
+    if (file) {
+        int ok = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(binary, written, 1, file) == 1;
+        ok = fclose(file) == 0 && ok;
+        if (!ok || rename(temporary, path) != 0) {
+            unlink(temporary);
+        }
+    }
+    free(binary);
+}
+
+// Function to hash the sources of a program
+static uint64_t source_hash(const char *vertex_source, const char *fragment_source) {
+    return program_cache_hash(fragment_source, program_cache_hash(vertex_source, 0));
+}
+
+// Function to load a linked program for the given sources from the cache.
+// Returns 0 on a miss.
+GLuint program_cache_load(ProgramCache *cache, const char *vertex_source, const char *fragment_source) {
+    if (!cache->available) {
+        return 0;
+    }
+    double start = clock_seconds(CLOCK_MONOTONIC);
+    GLuint program = load_binary(cache, source_hash(vertex_source, fragment_source));
+    if (program) {
+        double load_time = clock_seconds(CLOCK_MONOTONIC) - start;
+        cache->hits++;
+        cache->load_time += load_time;
+        cache->saved_time -= load_time;
+    }
+    return program;
+}
+
+// Function to record a program that had to be compiled, and store it for
+// the next start
+void program_cache_store(ProgramCache *cache, const char *vertex_source, const char *fragment_source,
+                         GLuint program, double compile_time) {
+    cache->misses++;
+    cache->compile_time += compile_time;
+    if (cache->available) {
+        store_binary(cache, source_hash(vertex_source, fragment_source), program, compile_time);
+    }
+}
+
+// Function to print the cache results of the startup
+void program_cache_report(const ProgramCache *cache, FILE *stream) {
+    if (!cache->available) {
+        fprintf(stream, "program cache: unavailable, %d program(s) compiled in %.1f ms\n", cache->misses,
+                cache->compile_time * 1000.0);
+        return;
+    }
+    fprintf(stream, "program cache: %d hit(s) loaded in %.1f ms, %d miss(es) compiled in %.1f ms, "
+            "%d rejected, %.1f ms of compile time saved\n", cache->hits, cache->load_time * 1000.0, cache->misses,
+            cache->compile_time * 1000.0, cache->rejected, cache->saved_time * 1000.0);
+}
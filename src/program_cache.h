@@ -0,0 +1,46 @@
+/**
+ * On-disk cache of linked GLSL program binaries.
+ *
+ * Binaries from glGetProgramBinary() are stored under
+ * $XDG_CACHE_HOME/desktop_cube (~/.cache/desktop_cube without it), named by
+ * a hash of the driver's vendor and renderer strings (the device), a hash
+ * of its version string and a hash of the shader sources. A driver update
+ * changes the name, so stale binaries are never loaded; when the cache is
+ * opened, binaries of the same device with another version are deleted.
+ * Those of other devices are kept, since other screens or instances may
+ * render with them at the same time. Files are
+ * written to a temporary name and renamed, so concurrent renderers and
+ * crashes never leave a partial binary behind.
+ */
+
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <GL/glew.h>
+
+typedef struct {
+    int available;          // GL_ARB_get_program_binary with at least one format
+    char directory[4096];
+    uint64_t device_hash;   // Vendor and renderer
+    uint64_t version_hash;  // Driver version
+
+    // Startup report
+    int hits;
+    int misses;
+    int rejected;           // Binaries the driver refused to load
+    double load_time;       // Seconds spent loading cached binaries
+    double compile_time;    // Seconds spent compiling on misses
+    double saved_time;      // Compile time of the cached binaries minus load time
+} ProgramCache;
+
+uint64_t program_cache_hash(const char *text, uint64_t hash);
+int program_cache_open(ProgramCache *cache);
+GLuint program_cache_load(ProgramCache *cache, const char *vertex_source, const char *fragment_source);
+void program_cache_store(ProgramCache *cache, const char *vertex_source, const char *fragment_source,
+                         GLuint program, double compile_time);
+void program_cache_report(const ProgramCache *cache, FILE *stream);
+
+#endif
@@ -0,0 +1,1827 @@
+/**
+ * Per-X-screen renderer, see renderer.h.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/timerfd.h>
+
+#include <GL/glew.h>
+#include <GL/glx.h>
+
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/Xinerama.h>
+
+// Color Palette
+#include "nord.h"
+
+#include "control.h"
+#include "gl_state.h"
+#include "layout.h"
+#include "probes.h"
+#include "renderer.h"
+#include "shader.h"
+#include "transform.h"
+
+#define APP_TITLE "OPENGL DESKTOP"
+
+// Frame rate cap of the low-cost profile
+static const int LOW_COST_FPS = 15;
+
+// Interval for polling DPMS state, which has no events
+static const int IDLE_POLL_INTERVAL = 2000000;
+
+// Unused names in a row that end the probe for live GL objects
+#define SOAK_GL_GAP 256
+
+// Frames rendered with the changed layout in each soak exercise
+#define SOAK_LAYOUT_FRAMES 30
+
+// Soak intervals between recreations of the window and context. Leaks that
+// build up in a long-lived context show in the intervals in between.
+#define SOAK_RECREATE_INTERVALS 5
+
+// Reasons for rendering to be paused, any set bit stops the frame timer
+enum {
+    PAUSE_HIDDEN = 1 << 0,       // Window unmapped or fully obscured
+    PAUSE_SCREENSAVER = 1 << 1,  // MIT-SCREEN-SAVER reports the saver is on
+    PAUSE_DPMS = 1 << 2,         // Monitors are in standby, suspend or off
+    PAUSE_SLEEP = 1 << 3,        // logind announced an imminent system sleep
+    PAUSE_USER = 1 << 4,         // Paused through the control socket
+    PAUSE_LOCKED = 1 << 5,       // logind reports the session as locked
+};
+
+// Pause reasons a group leader detects on behalf of the other outputs
+#define FORWARDED_PAUSE (PAUSE_HIDDEN | PAUSE_SCREENSAVER | PAUSE_DPMS)
+
+// GLX attributes for OpenGL context creation
+static int glx_attributes[] = {
+    GLX_RGBA,               // Use RGBA color mode
+    GLX_DOUBLEBUFFER,       // Enable double buffering
+    GLX_RED_SIZE, 8,        // 8 bits for the red channel
+    GLX_GREEN_SIZE, 8,      // 8 bits for the green channel
+    GLX_BLUE_SIZE, 8,       // 8 bits for the blue channel
+    GLX_DEPTH_SIZE, 24,     // 24 bits for the depth buffer
+    GLX_SAMPLE_BUFFERS, 1,  // Enable multisampling
+    GLX_SAMPLES, 4,         // Antialiasing samples, set from the config
+    None                    // Terminate the attribute list
+};
+
+
+// 3D cube vertices and indices
+static GLfloat vertices[] = {
+    -1.0, -1.0, 1.0,   // 0 Bottom Left Front
+    1.0,  -1.0, 1.0,   // 1 Bottom Right Front
+    1.0,  -1.0, -1.0,  // 2 Bottom Right Back
+    -1.0, -1.0, -1.0,  // 3 Bottom Left Back
+    -1.0, 1.0,  1.0,   // 4 Top Left Front
+    1.0,  1.0,  1.0,   // 5 Top Right Front
+    1.0,  1.0,  -1.0,  // 6 Top Right Back
+    -1.0, 1.0,  -1.0   // 7 Top Left Back
+};
+
+static GLubyte indices[] = {
+    0, 1, 2, 3,  // Bottom
+    4, 5, 6, 7,  // Top
+    0, 4, 7, 3,  // Left
+    1, 5, 6, 2,  // Right
+    0, 1, 5, 4,  // Back
+    3, 7, 6, 2   // Front
+};
+
+// Number of cube vertices, each colored from the config
+#define NUM_VERTICES 8
+
+// Serializes glewInit() across renderer threads
+static pthread_mutex_t glew_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Function to check whether this renderer reads the X connection's events.
+// Within an output group only the leader does.
+static int handles_events(Renderer *renderer) {
+    return !renderer->group || renderer->output == 0;
+}
+
+// Function to print which screen and output a renderer draws
+static void print_name(Renderer *renderer, FILE *stream) {
+    fprintf(stream, "screen %d", renderer->screen);
+    if (renderer->group) {
+        fprintf(stream, " output %d", renderer->output);
+    }
+}
+
+// Function to destroy the window, GLX context and GL objects
+static void destroy_surface(Renderer *renderer) {
+    // Objects in a group's share group are freed with the last context
+    if (!renderer->group) {
+        if (renderer->vertex_buffer) glDeleteBuffers(1, &renderer->vertex_buffer);
+        if (renderer->index_buffer) glDeleteBuffers(1, &renderer->index_buffer);
+        if (renderer->color_buffer) glDeleteBuffers(1, &renderer->color_buffer);
+        if (renderer->cube_list) glDeleteLists(renderer->cube_list, 1);
+    }
+    if (renderer->screen_lists) glDeleteLists(renderer->screen_lists, renderer->num_screen_lists);
+    if (renderer->use_shaders) shader_manager_destroy(&renderer->shaders);
+    gpu_timer_destroy(&renderer->gpu_timer);
+    if (renderer->glx_context) {
+        glXMakeCurrent(renderer->display, None, NULL);
+        glXDestroyContext(renderer->display, renderer->glx_context);
+    }
+    if (renderer->window) XDestroyWindow(renderer->display, renderer->window);
+    if (renderer->color_map) XFreeColormap(renderer->display, renderer->color_map);
+    if (renderer->visual_info) XFree(renderer->visual_info);
+    renderer->vertex_buffer = 0;
+    renderer->index_buffer = 0;
+    renderer->color_buffer = 0;
+    renderer->cube_list = 0;
+    renderer->screen_lists = 0;
+    renderer->use_shaders = 0;
+    renderer->glx_context = NULL;
+    renderer->window = None;
+    renderer->color_map = None;
+    renderer->visual_info = NULL;
+}
+
+// Function to handle cleanup
+static void cleanup(Renderer *renderer) {
+    // A recording cut short keeps the frames it has
+    if (gl_recorder) gl_record_close(renderer->width, renderer->height);
+    event_loop_destroy(&renderer->loop);
+    scheduler_destroy(&renderer->scheduler);
+    if (renderer->idle_timer_fd >= 0) close(renderer->idle_timer_fd);
+    if (renderer->display) destroy_surface(renderer);
+    if (renderer->trace) fclose(renderer->trace);
+    perf_counters_close(&renderer->perf);
+    free(renderer->screen_info);
+    if (renderer->display && !renderer->group) XCloseDisplay(renderer->display);
+    renderer->display = NULL;
+}
+
+// Function to check whether a display name refers to another host. Local
+// connections are ":0", "unix:0" or a socket path; anything with a host
+// part (including "localhost:10" from SSH forwarding) goes over TCP.
+static int is_remote_display(const char *name) {
+    if (!name || name[0] == '/' || name[0] == ':') {
+        return 0;
+    }
+    const char *colon = strrchr(name, ':');
+    size_t host_length = colon ? (size_t)(colon - name) : strlen(name);
+    return !(host_length == 4 && strncmp(name, "unix", 4) == 0);
+}
+
+// Function to choose a GLX visual with the given number of samples, 0 for
+// no multisampling. Falls back to a single-sampled visual if no multisampled
+// one is available.
+static XVisualInfo *choose_visual(Display *display, int screen, int samples) {
+    int attributes[sizeof(glx_attributes) / sizeof(glx_attributes[0])];
+    memcpy(attributes, glx_attributes, sizeof(glx_attributes));
+    for (int i = 0; attributes[i] != None; i += 2) {
+        if (attributes[i] == GLX_RGBA || attributes[i] == GLX_DOUBLEBUFFER) {
+            i--;  // Boolean attributes have no value
+        } else if (attributes[i] == GLX_SAMPLES) {
+            attributes[i + 1] = samples;
+        }
+    }
+
+    XVisualInfo *visual_info = NULL;
+    if (samples > 0) {
+        visual_info = glXChooseVisual(display, screen, attributes);
+    }
+    if (!visual_info) {
+        // Truncate the list before the multisampling attributes
+        for (int i = 0; attributes[i] != None; i++) {
+            if (attributes[i] == GLX_SAMPLE_BUFFERS) {
+                attributes[i] = None;
+                break;
+            }
+        }
+        visual_info = glXChooseVisual(display, screen, attributes);
+    }
+    return visual_info;
+}
+
+// Function to expand the configured colors to one per cube vertex
+static void vertex_colors(Renderer *renderer, GLfloat colors[NUM_VERTICES][4]) {
+    config_vertex_colors(&renderer->config, colors, NUM_VERTICES);
+}
+
+// Function to record a call that reads a client array. The array goes into
+// the recording, since the pointer means nothing on replay.
+static void record_client_array(int op, GLenum a, GLenum b, GLenum c, const void *data, size_t size) {
+    if (gl_recorder) {
+        const uint32_t words[] = {a, b, c, 0};
+        gl_record_call(op, words, 4, data, size);
+    }
+}
+
+// Function to upload the cube geometry into buffer objects
+static void setup_buffers(Renderer *renderer) {
+    GLfloat colors[NUM_VERTICES][4];
+    vertex_colors(renderer, colors);
+
+    // Generate and set up the vertex buffer.
+    glGenBuffers(1, &renderer->vertex_buffer);
+    GL_RECORD(RECORD_GEN_BUFFER, renderer->vertex_buffer);
+    gl_state_bind_buffer(&renderer->gl, GL_ARRAY_BUFFER, renderer->vertex_buffer);
+    GL_INSTRUMENT(GL_CATEGORY_UPLOAD, glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW));
+    gl_instrument_upload(sizeof(vertices));
+    record_client_array(RECORD_BUFFER_DATA, GL_ARRAY_BUFFER, GL_STATIC_DRAW, 0, vertices, sizeof(vertices));
+
+    // Generate and set up the index buffer.
+    glGenBuffers(1, &renderer->index_buffer);
+    GL_RECORD(RECORD_GEN_BUFFER, renderer->index_buffer);
+    gl_state_bind_buffer(&renderer->gl, GL_ELEMENT_ARRAY_BUFFER, renderer->index_buffer);
+    GL_INSTRUMENT(GL_CATEGORY_UPLOAD, glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices,
+                                                   GL_STATIC_DRAW));
+    gl_instrument_upload(sizeof(indices));
+    record_client_array(RECORD_BUFFER_DATA, GL_ELEMENT_ARRAY_BUFFER, GL_STATIC_DRAW, 0, indices, sizeof(indices));
+
+    // Generate and set up the color buffer.
+    glGenBuffers(1, &renderer->color_buffer);
+    GL_RECORD(RECORD_GEN_BUFFER, renderer->color_buffer);
+    gl_state_bind_buffer(&renderer->gl, GL_ARRAY_BUFFER, renderer->color_buffer);
+    GL_INSTRUMENT(GL_CATEGORY_UPLOAD, glBufferData(GL_ARRAY_BUFFER, sizeof(colors), colors, GL_DYNAMIC_DRAW));
+    gl_instrument_upload(sizeof(colors));
+    record_client_array(RECORD_BUFFER_DATA, GL_ARRAY_BUFFER, GL_DYNAMIC_DRAW, 0, colors, sizeof(colors));
+}
+
+// Function to point the vertex arrays of the current context at the buffers
+static void bind_buffers(Renderer *renderer) {
+    gl_state_bind_buffer(&renderer->gl, GL_ARRAY_BUFFER, renderer->vertex_buffer);
+    glVertexPointer(3, GL_FLOAT, 0, NULL);
+    GL_RECORD(RECORD_VERTEX_POINTER, 3, GL_FLOAT, 0, 0);
+    gl_state_bind_buffer(&renderer->gl, GL_ARRAY_BUFFER, renderer->color_buffer);
+    glColorPointer(4, GL_FLOAT, 0, NULL);
+    GL_RECORD(RECORD_COLOR_POINTER, 4, GL_FLOAT, 0, 0);
+    gl_state_bind_buffer(&renderer->gl, GL_ELEMENT_ARRAY_BUFFER, renderer->index_buffer);
+}
+
+// Function to compile the cube geometry into a display list. With indirect
+// GLX the list lives in the server, so drawing it is a single small request
+// instead of sending the vertex data every frame.
+static void setup_display_list(Renderer *renderer) {
+    GLfloat colors[NUM_VERTICES][4];
+    vertex_colors(renderer, colors);
+    glVertexPointer(3, GL_FLOAT, 0, vertices);
+    record_client_array(RECORD_VERTEX_POINTER, 3, GL_FLOAT, 0, vertices, sizeof(vertices));
+    glColorPointer(4, GL_FLOAT, 0, colors);
+    record_client_array(RECORD_COLOR_POINTER, 4, GL_FLOAT, 0, colors, sizeof(colors));
+
+    // Recompiling an existing list replaces it in place
+    if (!renderer->cube_list) {
+        renderer->cube_list = glGenLists(1);
+        GL_RECORD(RECORD_GEN_LISTS, renderer->cube_list, 1);
+    }
+    gl_state_begin_list(&renderer->gl, renderer->cube_list);
+    GL_INSTRUMENT(GL_CATEGORY_UPLOAD, glDrawElements(GL_QUADS, 24, GL_UNSIGNED_BYTE, indices));
+    gl_instrument_upload(sizeof(vertices) + sizeof(colors) + sizeof(indices));
+    record_client_array(RECORD_DRAW_ELEMENTS, GL_QUADS, 24, GL_UNSIGNED_BYTE, indices, sizeof(indices));
+    gl_state_end_list(&renderer->gl);
+}
+
+// Function to query the monitors of an X screen into a malloc'd array.
+// Xinerama merges all monitors into one X screen; without it (e.g. separate
+// X screens per monitor) the X screen is a single monitor. With `split`, the
+// screen is instead divided into that many equal side-by-side outputs, e.g.
+// to benchmark scaling with the number of outputs on a single monitor.
+// Returns the number of monitors, or -1 on failure.
+int query_monitors(Display *display, int screen, int split, XineramaScreenInfo **monitors) {
+    int count = 1;
+    XineramaScreenInfo *xinerama = NULL;
+    if (split <= 0 && XineramaIsActive(display)) {
+        xinerama = XineramaQueryScreens(display, &count);
+        if (!xinerama) {
+            return -1;
+        }
+    }
+    if (split > 0) {
+        count = split;
+    }
+
+    XineramaScreenInfo *result = calloc(count, sizeof(*result));
+    if (!result) {
+        if (xinerama) XFree(xinerama);
+        return -1;
+    }
+    int width = DisplayWidth(display, screen);
+    int height = DisplayHeight(display, screen);
+    for (int i = 0; i < count; i++) {
+        if (xinerama) {
+            result[i] = xinerama[i];
+        } else {
+            result[i].screen_number = i;
+            result[i].x_org = (long)width * i / count;
+            result[i].width = (long)width * (i + 1) / count - result[i].x_org;
+            result[i].height = height;
+        }
+    }
+    if (xinerama) XFree(xinerama);
+    *monitors = result;
+    return count;
+}
+
+// Function to query the monitor layout and the combined size of all monitors
+static int query_layout(Renderer *renderer) {
+    XineramaScreenInfo *screen_info = NULL;
+    int number_of_screens =
+        query_monitors(renderer->display, renderer->screen, renderer->split, &screen_info);
+    if (number_of_screens <= 0) {
+        fprintf(stderr, "Failed to query multi-monitor information\n");
+        return -1;
+    }
+
+    // A group output renders just its own monitor, from a window placed
+    // over it
+    renderer->window_x = 0;
+    renderer->window_y = 0;
+    if (renderer->group) {
+        if (renderer->output >= number_of_screens) {
+            fprintf(stderr, "Output %d of screen %d no longer exists\n", renderer->output, renderer->screen);
+            free(screen_info);
+            return -1;
+        }
+        screen_info[0] = screen_info[renderer->output];
+        renderer->window_x = screen_info[0].x_org;
+        renderer->window_y = screen_info[0].y_org;
+        screen_info[0].x_org = 0;
+        screen_info[0].y_org = 0;
+        number_of_screens = 1;
+    }
+    free(renderer->screen_info);
+    renderer->screen_info = screen_info;
+    renderer->num_screens = number_of_screens;
+
+    layout_bounds(renderer->screen_info, number_of_screens, &renderer->width, &renderer->height);
+    return 0;
+}
+
+// Function to set the viewport, projection and camera for one screen. With
+// a single screen the viewport and projection stay the same from frame to
+// frame, and the state tracker filters them out.
+static void setup_screen_view(Renderer *renderer, int i) {
+    // Define the viewport for the current screen
+    gl_state_viewport(
+        &renderer->gl,
+        renderer->screen_info[i].x_org,
+        renderer->screen_info[i].y_org,
+        renderer->screen_info[i].width,
+        renderer->screen_info[i].height
+    );
+
+    // Set projection matrix for perspective rendering
+    GLfloat aspect = (GLfloat)renderer->screen_info[i].width / (GLfloat)renderer->screen_info[i].height;
+    if (gl_state_need_projection(&renderer->gl, aspect)) {
+        GLfloat projection[16];
+        matrix_perspective(projection, 50.0f, aspect, 0.1f, 10.0f);
+        gl_state_matrix_mode(&renderer->gl, GL_PROJECTION);
+        GL_INSTRUMENT(GL_CATEGORY_STATE, glLoadMatrixf(projection));
+        if (gl_recorder) gl_record_floats(RECORD_LOAD_MATRIX, projection, 16);
+    }
+
+    // Set the model view matrix and define the camera's
+    // position and orientation
+    static const GLfloat center[3] = {0.0f, 0.0f, 0.0f};
+    static const GLfloat up[3] = {0.0f, 1.0f, 0.0f};
+    GLfloat view[16];
+    matrix_look_at(view, renderer->config.camera, center, up);
+    gl_state_matrix_mode(&renderer->gl, GL_MODELVIEW);
+    GL_INSTRUMENT(GL_CATEGORY_STATE, glLoadMatrixf(view));
+    if (gl_recorder) gl_record_floats(RECORD_LOAD_MATRIX, view, 16);
+}
+
+// Function to compile the per-screen view setup into display lists, so each
+// frame only issues the rotation on top. Rebuilt whenever the layout changes.
+static void build_screen_lists(Renderer *renderer) {
+    if (renderer->screen_lists) {
+        glDeleteLists(renderer->screen_lists, renderer->num_screen_lists);
+        GL_RECORD(RECORD_DELETE_LISTS, renderer->screen_lists, renderer->num_screen_lists);
+    }
+    renderer->screen_lists = glGenLists(renderer->num_screens);
+    GL_RECORD(RECORD_GEN_LISTS, renderer->screen_lists, renderer->num_screens);
+    renderer->num_screen_lists = renderer->num_screens;
+    for (int i = 0; i < renderer->num_screens; i++) {
+        gl_state_begin_list(&renderer->gl, renderer->screen_lists + i);
+        setup_screen_view(renderer, i);
+        gl_state_end_list(&renderer->gl);
+    }
+}
+
+// Function to follow a change of the monitor layout
+static void update_layout(Renderer *renderer) {
+    if (query_layout(renderer) != 0) {
+        return;
+    }
+    XMoveResizeWindow(renderer->display, renderer->window, renderer->window_x, renderer->window_y,
+                      renderer->width, renderer->height);
+    if (renderer->screen_lists) {
+        build_screen_lists(renderer);
+    }
+}
+
+// Function to start an output group for the given number of outputs
+int output_group_init(OutputGroup *group, Display *display, int screen, int num_outputs) {
+    memset(group, 0, sizeof(*group));
+    group->display = display;
+    group->screen = screen;
+    group->num_outputs = num_outputs;
+    group->members = calloc(num_outputs, sizeof(Renderer *));
+    if (!group->members) {
+        return -1;
+    }
+    animation_clock_init(&group->clock, num_outputs, clock_seconds(CLOCK_MONOTONIC));
+    pthread_mutex_init(&group->lock, NULL);
+    pthread_cond_init(&group->ready_cond, NULL);
+    return 0;
+}
+
+// Function to release an output group once all its renderers have finished
+void output_group_destroy(OutputGroup *group) {
+    if (!group->members) {
+        return;
+    }
+    animation_clock_destroy(&group->clock);
+    pthread_cond_destroy(&group->ready_cond);
+    pthread_mutex_destroy(&group->lock);
+    free(group->members);
+    group->members = NULL;
+}
+
+// Function to mark the group's shared objects as available (1) or as never
+// going to be (-1), waking up the outputs waiting for them
+static void group_set_ready(OutputGroup *group, int ready) {
+    pthread_mutex_lock(&group->lock);
+    group->ready = ready;
+    pthread_cond_broadcast(&group->ready_cond);
+    pthread_mutex_unlock(&group->lock);
+}
+
+// Function to wait for the leader's context to share objects with. Returns
+// NULL if the leader failed.
+static GLXContext group_wait_ready(OutputGroup *group) {
+    pthread_mutex_lock(&group->lock);
+    while (group->ready == 0) {
+        pthread_cond_wait(&group->ready_cond, &group->lock);
+    }
+    GLXContext share_context = group->ready > 0 ? group->share_context : NULL;
+    pthread_mutex_unlock(&group->lock);
+    return share_context;
+}
+
+// Function to publish the leader's uploaded objects to the group. A fence
+// lets the other contexts wait on the GPU for the uploads to complete
+// instead of stalling here with glFinish().
+static void group_publish(Renderer *renderer) {
+    OutputGroup *group = renderer->group;
+    pthread_mutex_lock(&group->lock);
+    group->share_context = renderer->glx_context;
+    group->vertex_buffer = renderer->vertex_buffer;
+    group->index_buffer = renderer->index_buffer;
+    group->color_buffer = renderer->color_buffer;
+    group->cube_list = renderer->cube_list;
+    if (GLEW_ARB_sync) {
+        group->ready_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+    } else {
+        glFinish();
+    }
+    pthread_mutex_unlock(&group->lock);
+    group_set_ready(group, 1);
+}
+
+// Function to adopt the group's shared objects in a non-leader context
+static void group_adopt(Renderer *renderer) {
+    OutputGroup *group = renderer->group;
+    pthread_mutex_lock(&group->lock);
+    if (group->ready_fence) {
+        glWaitSync(group->ready_fence, 0, GL_TIMEOUT_IGNORED);
+    }
+    renderer->vertex_buffer = group->vertex_buffer;
+    renderer->index_buffer = group->index_buffer;
+    renderer->color_buffer = group->color_buffer;
+    renderer->cube_list = group->cube_list;
+    pthread_mutex_unlock(&group->lock);
+}
+
+// Function to find the group member that owns a window, NULL if none
+static Renderer *group_member_for_window(OutputGroup *group, Window window) {
+    Renderer *member = NULL;
+    pthread_mutex_lock(&group->lock);
+    for (int i = 0; i < group->num_outputs && !member; i++) {
+        if (group->members[i] && group->members[i]->window == window) {
+            member = group->members[i];
+        }
+    }
+    pthread_mutex_unlock(&group->lock);
+    return member;
+}
+
+// Function to post a request to the other outputs of the group
+static void group_post(Renderer *renderer, int request) {
+    if (!renderer->group) {
+        return;
+    }
+    for (int i = 0; i < renderer->group->num_outputs; i++) {
+        Renderer *member = renderer->group->members[i];
+        if (member && member != renderer) {
+            renderer_post(member, request);
+        }
+    }
+}
+
+// Function to get the frame rate to render at: the configured one, capped
+// by the low-cost profile
+static int effective_fps(Renderer *renderer) {
+    int fps = renderer->config.target_fps;
+    return renderer->low_cost && fps > LOW_COST_FPS ? LOW_COST_FPS : fps;
+}
+
+// Function to log the state of the shader programs
+static void report_shaders(Renderer *renderer) {
+    flockfile(stderr);
+    print_name(renderer, stderr);
+    fprintf(stderr, ": ");
+    shader_manager_report(&renderer->shaders, stderr);
+    funlockfile(stderr);
+}
+
+// Function to switch to the best program ready so far, and lay out its
+// instanced cubes
+static void use_best_program(Renderer *renderer) {
+    GLuint program = shader_manager_program(&renderer->shaders);
+    gl_state_use_program(&renderer->gl, program);
+    if (program && renderer->cubes > 1) {
+        int side = 1;
+        while (side * side * side < renderer->cubes) {
+            side++;
+        }
+        glUniform1f(glGetUniformLocation(program, "grid"), (GLfloat)side);
+    }
+}
+
+// Function to start building the GLSL programs. Frames are drawn with the
+// best program ready so far, or the fixed-function path until one is.
+static void setup_shaders(Renderer *renderer) {
+    if (!GLEW_VERSION_2_1) {
+        fprintf(stderr, "OpenGL 2.1 not available, using the fixed-function path\n");
+        return;
+    }
+    renderer->use_shaders = 1;
+
+    // Instances are drawn from the buffers, since instanced draws do not
+    // go into display lists
+    if (renderer->options->cubes > 1) {
+        if (!GLEW_ARB_draw_instanced) {
+            fprintf(stderr, "GL_ARB_draw_instanced not available, drawing one cube\n");
+        } else if (renderer->use_display_lists) {
+            fprintf(stderr, "Instanced cubes need buffer objects, drawing one cube with display lists\n");
+        } else {
+            renderer->cubes = renderer->options->cubes;
+        }
+    }
+    shader_manager_start(&renderer->shaders);
+    use_best_program(renderer);
+    if (!renderer->shaders.pending) {
+        report_shaders(renderer);
+    }
+}
+
+// Function to switch to better programs as they finish compiling
+static void update_shaders(Renderer *renderer) {
+    if (shader_manager_poll(&renderer->shaders)) {
+        use_best_program(renderer);
+    }
+    if (!renderer->shaders.pending) {
+        report_shaders(renderer);
+    }
+}
+
+// Function to estimate the memory of the window's buffers from its visual:
+// front and back color buffers, plus multisampled color and depth/stencil
+// (or single-sampled depth/stencil). Drivers may pad or compress them.
+static void estimate_framebuffer(Renderer *renderer) {
+    int color_bits = 0, depth_bits = 0, stencil_bits = 0, samples = 0;
+    glXGetConfig(renderer->display, renderer->visual_info, GLX_BUFFER_SIZE, &color_bits);
+    glXGetConfig(renderer->display, renderer->visual_info, GLX_DEPTH_SIZE, &depth_bits);
+    glXGetConfig(renderer->display, renderer->visual_info, GLX_STENCIL_SIZE, &stencil_bits);
+    glXGetConfig(renderer->display, renderer->visual_info, GLX_SAMPLES, &samples);
+    // 24-bit color and depth are stored in 32 bits
+    double color = (color_bits + 7) / 8 == 3 ? 4 : (color_bits + 7) / 8;
+    double depth_stencil = (depth_bits + stencil_bits + 31) / 32 * 4;
+    double pixels = (double)renderer->width * renderer->height;
+    renderer->samples = samples;
+    renderer->framebuffer_bytes = pixels * (2 * color + (samples > 0 ? samples : 1) * depth_stencil +
+                                            (samples > 0 ? samples * color : 0));
+}
+
+// Function to create the window, GLX context and GL objects. Apart from the
+// initial setup this only runs when a new visual is needed.
+static int create_surface(Renderer *renderer) {
+    // Get a suitable visual for OpenGL rendering
+    PROBE3(init_phase, renderer->screen, renderer->output, "visual");
+    Window root = RootWindow(renderer->display, renderer->screen);
+    int samples = renderer->low_cost ? 0 : renderer->config.samples;
+    renderer->visual_info = choose_visual(renderer->display, renderer->screen, samples);
+    if (!renderer->visual_info) {
+        fprintf(stderr, "No appropriate visual found\n");
+        return -1;
+    }
+    estimate_framebuffer(renderer);
+
+    // Create a colormap and set window attributes
+    renderer->color_map = XCreateColormap(renderer->display, root, renderer->visual_info->visual, AllocNone);
+    if (!renderer->color_map) {
+        fprintf(stderr, "Failed to create colormap\n");
+        return -1;
+    }
+    XSetWindowAttributes window_attributes = {
+        .colormap = renderer->color_map,
+        .event_mask = ExposureMask | KeyPressMask | VisibilityChangeMask | StructureNotifyMask
+    };
+
+    // Create an X window and set its name
+    PROBE3(init_phase, renderer->screen, renderer->output, "window");
+    Window window = XCreateWindow(renderer->display, root, renderer->window_x, renderer->window_y,
+                                  renderer->width, renderer->height, 0,
+                                  renderer->visual_info->depth, InputOutput, renderer->visual_info->visual,
+                                  CWColormap | CWEventMask, &window_attributes);
+    if (renderer->group) {
+        pthread_mutex_lock(&renderer->group->lock);
+        renderer->window = window;
+        pthread_mutex_unlock(&renderer->group->lock);
+    } else {
+        renderer->window = window;
+    }
+    if (!renderer->window) {
+        fprintf(stderr, "Failed to create window\n");
+        return -1;
+    }
+    XStoreName(renderer->display, renderer->window, APP_TITLE);
+
+    // Create an OpenGL rendering context, in the leader's share group for
+    // the other outputs of a group, or in the soak test's across recreation
+    PROBE3(init_phase, renderer->screen, renderer->output, "context");
+    GLXContext share_context = renderer->soak_context;
+    if (renderer->group && renderer->output > 0) {
+        share_context = group_wait_ready(renderer->group);
+        if (!share_context) {
+            fprintf(stderr, "Output %d of screen %d: group leader failed\n", renderer->output, renderer->screen);
+            return -1;
+        }
+    }
+    if (renderer->options->gl_debug) {
+        renderer->glx_context = gl_debug_create_context(renderer->display, renderer->visual_info, share_context);
+    } else {
+        renderer->glx_context = glXCreateContext(renderer->display, renderer->visual_info, share_context, GL_TRUE);
+    }
+    if (!renderer->glx_context) {
+        fprintf(stderr, "Failed to create GLX context\n");
+        return -1;
+    }
+
+    // With an indirect context every GL call becomes X protocol traffic, so
+    // trade quality for bandwidth
+    if (!glXIsDirect(renderer->display, renderer->glx_context)) {
+        renderer->low_cost = 1;
+    }
+    renderer->target_fps = effective_fps(renderer);
+    renderer->use_display_lists = renderer->options->use_display_lists || renderer->low_cost;
+    renderer->cubes = 1;
+
+    // Set the window type to desktop
+    Atom net_wm_window_type = XInternAtom(renderer->display, "_NET_WM_WINDOW_TYPE", False);
+    Atom net_wm_window_type_desktop =
+        XInternAtom(renderer->display, "_NET_WM_WINDOW_TYPE_DESKTOP", False);
+    XChangeProperty(renderer->display, renderer->window, net_wm_window_type, XA_ATOM, 32,
+                    PropModeReplace, (unsigned char *)&net_wm_window_type_desktop,
+                    1);
+    compositor_set_bypass(renderer->display, renderer->window, renderer->options->bypass_compositor);
+    XMapWindow(renderer->display, renderer->window);
+
+    // Initialize GLEW for OpenGL extensions. Its entry points are process
+    // globals, so renderers starting in parallel take turns.
+    PROBE3(init_phase, renderer->screen, renderer->output, "glew");
+    glXMakeCurrent(renderer->display, renderer->window, renderer->glx_context);
+    gl_state_reset(&renderer->gl);
+    renderer->gl.bypass = renderer->options->no_state_cache;
+    pthread_mutex_lock(&glew_lock);
+    GLenum glew_status = glewInit();
+    pthread_mutex_unlock(&glew_lock);
+    if (glew_status != GLEW_OK) {
+        fprintf(stderr, "Failed to initialize GLEW\n");
+        return -1;
+    }
+
+    snprintf(renderer->gl_renderer, sizeof(renderer->gl_renderer), "%s",
+             (const char *)glGetString(GL_RENDERER));
+    if (renderer->options->gl_debug) {
+        gl_debug_start(&renderer->debug);
+    }
+
+    // Presentation feedback is optional; without it only CPU time is measured
+    PROBE3(init_phase, renderer->screen, renderer->output, "present");
+    if (present_init(&renderer->present, renderer->display, renderer->screen, renderer->window) == 0) {
+        renderer->present.schedule = renderer->options->schedule_msc;
+        present_set_target_fps(&renderer->present, renderer->target_fps);
+    } else if (renderer->options->schedule_msc) {
+        fprintf(stderr, "GLX_OML_sync_control not available, swapping without a target MSC\n");
+    }
+    if (renderer->options->bench_seconds > 0) {
+        gpu_timer_init(&renderer->gpu_timer);
+    }
+
+    if (renderer->options->use_shaders) {
+        PROBE3(init_phase, renderer->screen, renderer->output, "shaders");
+        setup_shaders(renderer);
+    }
+
+    PROBE3(init_phase, renderer->screen, renderer->output, "geometry");
+    if (renderer->group && renderer->output > 0) {
+        group_adopt(renderer);
+    } else if (renderer->use_display_lists) {
+        setup_display_list(renderer);
+    } else {
+        setup_buffers(renderer);
+    }
+    if (renderer->use_display_lists) {
+        build_screen_lists(renderer);
+    } else {
+        bind_buffers(renderer);
+    }
+    if (renderer->group && renderer->output == 0) {
+        group_publish(renderer);
+    }
+
+    // Enable depth testing and multi-sampling for improved rendering quality.
+    gl_state_enable(&renderer->gl, GL_DEPTH_TEST, 1);
+    gl_state_enable(&renderer->gl, GL_MULTISAMPLE, samples > 0);
+
+    // Enable client-side capabilities for vertex and color arrays.
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    GL_RECORD(RECORD_ENABLE_CLIENT_STATE, GL_VERTEX_ARRAY);
+    GL_RECORD(RECORD_ENABLE_CLIENT_STATE, GL_COLOR_ARRAY);
+
+    // Set the background color
+    gl_state_clear_color(&renderer->gl, renderer->config.background);
+
+    return 0;
+}
+
+// Function to initialize X11 and OpenGL
+static int initialize(Renderer *renderer) {
+    // Open a connection to the X server. Every renderer has its own, so
+    // screens do not serialize on a shared Xlib lock. Outputs of a group
+    // share one, since GLX share groups cannot span connections.
+    PROBE3(init_phase, renderer->screen, renderer->output, "display");
+    renderer->display = renderer->group ? renderer->group->display : XOpenDisplay(NULL);
+    if (!renderer->display) {
+        fprintf(stderr, "Failed to open X display\n");
+        return -1;
+    }
+
+    PROBE3(init_phase, renderer->screen, renderer->output, "layout");
+    if (query_layout(renderer) != 0) {
+        return -1;
+    }
+
+    // A remote display gets the low-cost profile up front, so that no
+    // multisampled visual is requested
+    const char *display_name = DisplayString(renderer->display);
+    int remote = is_remote_display(display_name);
+    renderer->low_cost = remote;
+
+    // Recording starts before the context exists, so the setup is captured
+    if (renderer->record && gl_record_open(&renderer->recorder, renderer->options->record_path,
+                                           renderer->options->record_frames) != 0) {
+        return -1;
+    }
+    if (create_surface(renderer) != 0) {
+        return -1;
+    }
+    if (renderer->low_cost) {
+        fprintf(stderr, "%s on %s (screen %d): using low-cost profile (%d FPS, no multisampling, "
+                "display lists)\n", remote ? "Remote display" : "Indirect GLX context", display_name,
+                renderer->screen, renderer->target_fps);
+    }
+
+    // Root window size changes signal a new monitor layout
+    if (handles_events(renderer)) {
+        XSelectInput(renderer->display, RootWindow(renderer->display, renderer->screen), StructureNotifyMask);
+    }
+    compositor_init(&renderer->compositor, renderer->display, renderer->screen);
+
+    PROBE3(init_phase, renderer->screen, renderer->output, "done");
+    return 0;
+}
+
+// Function to start recording one line per frame into a CSV file in the
+// runtime directory
+static void start_trace(Renderer *renderer, int milliseconds) {
+    char name[64];
+    if (renderer->group) {
+        snprintf(name, sizeof(name), "desktop_cube-trace-%d-%d.csv", renderer->screen, renderer->output);
+    } else {
+        snprintf(name, sizeof(name), "desktop_cube-trace-%d.csv", renderer->screen);
+    }
+    if (renderer->trace) fclose(renderer->trace);
+    renderer->trace = NULL;
+    if (control_runtime_path(renderer->trace_path, sizeof(renderer->trace_path), name) != 0 ||
+        !(renderer->trace = fopen(renderer->trace_path, "w"))) {
+        fprintf(stderr, "Failed to start frame trace %s\n", renderer->trace_path);
+        return;
+    }
+    fprintf(renderer->trace, "time,cpu_ms,present_interval_ms,msc_delta");
+    for (int i = 0; i < GL_CATEGORIES; i++) {
+        fprintf(renderer->trace, ",%s_calls,%s_ms", gl_category_names[i], gl_category_names[i]);
+    }
+    fprintf(renderer->trace, ",upload_bytes\n");
+    renderer->trace_end = clock_seconds(CLOCK_MONOTONIC) + milliseconds / 1000.0;
+}
+
+// Function to record a frame in the trace, and finish it once it is due
+static void trace_frame(Renderer *renderer, double frame_start, double frame_time, const PresentSample *sample) {
+    if (sample) {
+        fprintf(renderer->trace, "%.6f,%.3f,%.3f,%ld", frame_start, frame_time * 1000.0, sample->interval_ms,
+                (long)sample->msc_delta);
+    } else {
+        fprintf(renderer->trace, "%.6f,%.3f,,", frame_start, frame_time * 1000.0);
+    }
+    // Driver columns stay empty without --instrument
+    if (gl_counters) {
+        for (int i = 0; i < GL_CATEGORIES; i++) {
+            fprintf(renderer->trace, ",%lu,%.3f", gl_counters->calls[i], gl_counters->time[i] * 1000.0);
+        }
+        fprintf(renderer->trace, ",%lu\n", gl_counters->upload_bytes);
+    } else {
+        fputs(",,,,,,,,,\n", renderer->trace);
+    }
+    if (frame_start >= renderer->trace_end) {
+        fclose(renderer->trace);
+        renderer->trace = NULL;
+        fprintf(stderr, "Frame trace written to %s\n", renderer->trace_path);
+    }
+}
+
+// Function to add the frame's GL call counters to the statistics. They are
+// reset after the trace has recorded them, in render_frame().
+static void count_driver_time(Renderer *renderer) {
+    const GlCounters *counters = &renderer->gl_counters;
+    double total = 0.0;
+    for (int i = 0; i < GL_CATEGORIES; i++) {
+        renderer->stats.driver_calls[i] += counters->calls[i];
+        renderer->stats.driver_seconds[i] += counters->time[i];
+        total += counters->time[i];
+    }
+    renderer->stats.upload_bytes += counters->upload_bytes;
+    renderer->stats.driver_frames++;
+    series_add(&renderer->stats.driver_time, total * 1000.0);
+}
+
+// Function to publish the renderer's summary for the control socket
+static void publish_summary(Renderer *renderer, double now) {
+    SeriesSummary frame_time;
+    series_summarize(&renderer->stats.cpu_time, &frame_time);
+    pthread_mutex_lock(&renderer->summary_lock);
+    renderer->summary.frames = renderer->frames_rendered;
+    renderer->summary.missed = renderer->frames_missed;
+    renderer->summary.pauses = renderer->pause_count;
+    renderer->summary.paused = renderer->paused != 0;
+    renderer->summary.frame_p50 = frame_time.p50;
+    renderer->summary.frame_p99 = frame_time.p99;
+    pthread_mutex_unlock(&renderer->summary_lock);
+    renderer->summary_time = now;
+}
+
+// Function to render a single frame on all screens
+static void render_frame(Renderer *renderer) {
+    double frame_start = clock_seconds(CLOCK_MONOTONIC);
+    PROBE3(frame_start, renderer->screen, renderer->output, renderer->frames_rendered);
+    perf_counters_begin(&renderer->perf);
+
+    // Read back when the previous frame actually reached the screen
+    PresentSample sample;
+    int presented;
+    GL_INSTRUMENT(GL_CATEGORY_SWAP,
+                  presented = present_collect(&renderer->present, renderer->display, renderer->window, &sample));
+    if (presented) {
+        series_add(&renderer->stats.present_interval, sample.interval_ms);
+        renderer->stats.presented++;
+        if (sample.msc_delta > renderer->present.swap_interval) {
+            renderer->stats.late++;
+        }
+        if (renderer->predicted_present > 0) {
+            series_add(&renderer->stats.latch_error,
+                       (sample.present_time - renderer->predicted_present) * 1000.0);
+        }
+    }
+
+    gpu_timer_collect(&renderer->gpu_timer, &renderer->stats.gpu_time);
+    gpu_timer_begin(&renderer->gpu_timer);
+
+    // Clear the screen
+    if (gl_recorder) gl_record_begin_frame();
+    GL_INSTRUMENT(GL_CATEGORY_DRAW, glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+    GL_RECORD(RECORD_CLEAR, GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // Update rotation angles. In late-latch mode they are sampled as late as
+    // possible, for the predicted presentation time of this frame, instead of
+    // the time the frame started.
+    double now = clock_seconds(CLOCK_MONOTONIC);
+    double animation_timestamp = now;
+    if (renderer->options->late_latch) {
+        double remaining = renderer->render_latency - (now - frame_start);
+        renderer->predicted_present = present_predict(&renderer->present, now, fmax(remaining, 0.0),
+                                                      1.0 / renderer->target_fps);
+        animation_timestamp = renderer->predicted_present;
+    }
+    float rotation_angle_x, rotation_angle_y;
+    rotation_angles(renderer->rotation_phase, renderer->config.rotation_speed,
+                    animation_clock_time(renderer->clock, animation_timestamp), &rotation_angle_x,
+                    &rotation_angle_y);
+
+    // Render cubes: loop through all screens,
+    // set their viewports, and draw cubes.
+    for (int i = 0; i <  renderer->num_screens; i++) {
+        // Name each pass for tools showing the frame structure
+        if (renderer->debug.active) {
+            char pass_name[32];
+            snprintf(pass_name, sizeof(pass_name), "monitor %d", i);
+            gl_debug_push_group(&renderer->debug, i, pass_name);
+        }
+        PROBE3(draw_start, renderer->screen, renderer->output, i);
+        if (renderer->screen_lists) {
+            GL_INSTRUMENT(GL_CATEGORY_DRAW, glCallList(renderer->screen_lists + i));
+            GL_RECORD(RECORD_CALL_LIST, renderer->screen_lists + i);
+            gl_state_invalidate_view(&renderer->gl);
+        } else {
+            setup_screen_view(renderer, i);
+        }
+        GL_INSTRUMENT(GL_CATEGORY_STATE, glRotatef(rotation_angle_x, 1.0f, 0.0f, 0.0f));
+        GL_INSTRUMENT(GL_CATEGORY_STATE, glRotatef(rotation_angle_y, 0.0f, 1.0f, 0.0f));
+        GL_RECORD_FLOATS(RECORD_ROTATE, rotation_angle_x, 1.0f, 0.0f, 0.0f);
+        GL_RECORD_FLOATS(RECORD_ROTATE, rotation_angle_y, 0.0f, 1.0f, 0.0f);
+
+        // Draw the cube, or all instances once a program places them
+        if (renderer->cube_list) {
+            GL_INSTRUMENT(GL_CATEGORY_DRAW, glCallList(renderer->cube_list));
+            GL_RECORD(RECORD_CALL_LIST, renderer->cube_list);
+        } else if (renderer->cubes > 1 && renderer->gl.program) {
+            GL_INSTRUMENT(GL_CATEGORY_DRAW,
+                          glDrawElementsInstancedARB(GL_QUADS, 24, GL_UNSIGNED_BYTE, NULL, renderer->cubes));
+        } else {
+            GL_INSTRUMENT(GL_CATEGORY_DRAW, glDrawElements(GL_QUADS, 24, GL_UNSIGNED_BYTE, NULL));
+            GL_RECORD(RECORD_DRAW_ELEMENTS, GL_QUADS, 24, GL_UNSIGNED_BYTE, 0);
+        }
+        PROBE3(draw_end, renderer->screen, renderer->output, i);
+        gl_debug_pop_group(&renderer->debug);
+    }
+
+    // Swap buffers for double buffering
+    gpu_timer_end(&renderer->gpu_timer);
+    PROBE2(swap_start, renderer->screen, renderer->output);
+    GL_INSTRUMENT(GL_CATEGORY_SWAP, present_swap(&renderer->present, renderer->display, renderer->window));
+    XFlush(renderer->display);
+    if (gl_recorder) gl_record_frame(renderer->width, renderer->height);
+    PROBE2(swap_end, renderer->screen, renderer->output);
+    perf_counters_end(&renderer->perf);
+    double frame_time = clock_seconds(CLOCK_MONOTONIC) - frame_start;
+    PROBE3(frame_end, renderer->screen, renderer->output, (long)(frame_time * 1e6));
+    series_add(&renderer->stats.cpu_time, frame_time * 1000.0);
+    renderer->stats.state_frames++;
+    renderer->stats.state_issued += renderer->gl.issued;
+    renderer->stats.state_filtered += renderer->gl.filtered;
+    renderer->gl.issued = 0;
+    renderer->gl.filtered = 0;
+    if (gl_counters) {
+        count_driver_time(renderer);
+    }
+    if (renderer->trace) {
+        trace_frame(renderer, frame_start, frame_time, presented ? &sample : NULL);
+    }
+    memset(&renderer->gl_counters, 0, sizeof(renderer->gl_counters));
+
+    // Smoothed submission latency for the late-latch prediction
+    renderer->render_latency += (frame_time - renderer->render_latency) * 0.1;
+    if (renderer->frames_rendered++ == 0) {
+        renderer->first_frame_time = clock_seconds(CLOCK_MONOTONIC) - renderer->init_start;
+    }
+
+    if (frame_start - renderer->summary_time >= 1.0) {
+        publish_summary(renderer, frame_start);
+    }
+
+    // Checked after the swap, so the first frames go out without waiting
+    if (renderer->use_shaders && renderer->shaders.pending) {
+        update_shaders(renderer);
+    }
+}
+
+// Function to get the frame interval in microseconds. Under a compositor the
+// interval is snapped to a whole number of refresh periods, so frames line
+// up with the compositor's repaint cycle instead of beating against it.
+static long frame_interval(Renderer *renderer) {
+    double refresh_rate = renderer->present.refresh_rate;
+    if (renderer->compositor.active && refresh_rate > 0) {
+        long vblanks = lround(refresh_rate / renderer->target_fps);
+        return lround((vblanks > 1 ? vblanks : 1) * 1e6 / refresh_rate);
+    }
+    return 1000000 / renderer->target_fps;
+}
+
+// Function to log the compositor state and adapt pacing to it
+static void update_compositor(Renderer *renderer) {
+    fprintf(stderr, "Compositor %s, frame interval %.3f ms\n",
+            renderer->compositor.active ? "active" : "not running", frame_interval(renderer) / 1000.0);
+    scheduler_set_interval(&renderer->scheduler, frame_interval(renderer));
+}
+
+// Function to apply a new configuration between frames. Everything but the
+// sample count is changed in the existing context; a new sample count needs
+// a new visual, so the window and context are recreated.
+static void apply_config(Renderer *renderer, const Config *config) {
+    Config old = renderer->config;
+    renderer->config = *config;
+
+    if (config->target_fps != old.target_fps) {
+        renderer->target_fps = effective_fps(renderer);
+        present_set_target_fps(&renderer->present, renderer->target_fps);
+        scheduler_set_interval(&renderer->scheduler, frame_interval(renderer));
+    }
+
+    // Keep the current angle when the speed changes, instead of jumping to
+    // where the new speed would have taken the cube by now
+    if (config->rotation_speed != old.rotation_speed) {
+        double seconds = animation_clock_time(renderer->clock, clock_seconds(CLOCK_MONOTONIC));
+        renderer->rotation_phase += (old.rotation_speed - config->rotation_speed) * seconds;
+    }
+
+    if (config->samples != old.samples && !renderer->low_cost) {
+        // Other outputs of a group share objects with this context
+        if (renderer->group) {
+            fprintf(stderr, "Sample count changes of grouped outputs take effect on restart\n");
+        } else {
+            destroy_surface(renderer);
+            if (create_surface(renderer) != 0) {
+                fprintf(stderr, "Failed to recreate the window for %d samples\n", config->samples);
+                renderer->running = 0;
+            }
+            return;
+        }
+    }
+
+    gl_state_clear_color(&renderer->gl, config->background);
+
+    // Shared geometry is updated by the group leader only
+    if (memcmp(config->colors, old.colors, sizeof(old.colors)) != 0 && handles_events(renderer)) {
+        if (renderer->use_display_lists) {
+            setup_display_list(renderer);
+        } else {
+            GLfloat colors[NUM_VERTICES][4];
+            vertex_colors(renderer, colors);
+            gl_state_bind_buffer(&renderer->gl, GL_ARRAY_BUFFER, renderer->color_buffer);
+            GL_INSTRUMENT(GL_CATEGORY_UPLOAD, glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(colors), colors));
+            gl_instrument_upload(sizeof(colors));
+            record_client_array(RECORD_BUFFER_SUB_DATA, GL_ARRAY_BUFFER, 0, 0, colors, sizeof(colors));
+        }
+    }
+
+    if (memcmp(config->camera, old.camera, sizeof(old.camera)) != 0 && renderer->screen_lists) {
+        build_screen_lists(renderer);
+    }
+}
+
+// Function to set or clear a pause reason. While any reason is set the
+// frame timer is disarmed, so the process sleeps in epoll_wait without any
+// wakeups, and the animation clock stands still.
+static void set_paused(Renderer *renderer, int reason, int paused) {
+    int was_paused = renderer->paused != 0;
+    if (paused) {
+        renderer->paused |= reason;
+    } else {
+        renderer->paused &= ~reason;
+    }
+    int is_paused = renderer->paused != 0;
+    if (was_paused == is_paused) {
+        return;
+    }
+
+    PROBE3(pause, renderer->screen, renderer->output, renderer->paused);
+    double now = clock_seconds(CLOCK_MONOTONIC);
+    if (is_paused) {
+        renderer->paused_since = now;
+        renderer->pause_count++;
+        animation_clock_pause(renderer->clock, now);
+    } else {
+        renderer->paused_total += now - renderer->paused_since;
+        animation_clock_resume(renderer->clock, now);
+        present_restart(&renderer->present);
+    }
+    if (is_paused) {
+        scheduler_stop(&renderer->scheduler);
+    } else {
+        scheduler_start(&renderer->scheduler);
+    }
+    publish_summary(renderer, now);
+}
+
+// Function to set a pause reason detected by a group leader on behalf of
+// another output
+static void forward_paused(Renderer *member, int reason, int paused) {
+    if (paused) {
+        atomic_fetch_or(&member->forwarded_pause, reason);
+    } else {
+        atomic_fetch_and(&member->forwarded_pause, ~reason);
+    }
+    renderer_post(member, REQUEST_SYNC_PAUSE);
+}
+
+// Function to set a pause reason that applies to the whole X screen
+static void set_screen_paused(Renderer *renderer, int reason, int paused) {
+    set_paused(renderer, reason, paused);
+    for (int i = 0; renderer->group && i < renderer->group->num_outputs; i++) {
+        Renderer *member = renderer->group->members[i];
+        if (member && member != renderer) {
+            forward_paused(member, reason, paused);
+        }
+    }
+}
+
+// Function to set a pause reason for whichever output owns a window
+static void set_window_paused(Renderer *renderer, Window window, int reason, int paused) {
+    if (window == renderer->window) {
+        set_paused(renderer, reason, paused);
+    } else if (renderer->group) {
+        Renderer *member = group_member_for_window(renderer->group, window);
+        if (member) {
+            forward_paused(member, reason, paused);
+        }
+    }
+}
+
+// Function to get the total time spent paused, including an ongoing pause
+static double paused_time(Renderer *renderer) {
+    double total = renderer->paused_total;
+    if (renderer->paused) {
+        total += clock_seconds(CLOCK_MONOTONIC) - renderer->paused_since;
+    }
+    return total;
+}
+
+// Function to print frame counters to stderr, without interleaving with
+// other renderer threads
+static void dump_stats(Renderer *renderer) {
+    flockfile(stderr);
+    print_name(renderer, stderr);
+    fprintf(stderr,
+            ": frames rendered: %lu, missed: %lu, paused: %s (reasons 0x%x), "
+            "pauses: %lu, paused time: %.1fs, stalls: %lu (%.1fs), suspends: %lu (%.1fs)\n",
+            renderer->frames_rendered, renderer->frames_missed, renderer->paused ? "yes" : "no",
+            renderer->paused, renderer->pause_count, paused_time(renderer), renderer->scheduler.gaps,
+            renderer->scheduler.gap_time, renderer->scheduler.suspends, renderer->scheduler.suspend_time);
+    frame_stats_print(stderr, &renderer->stats);
+    perf_counters_print(stderr, &renderer->perf);
+    if (renderer->options->gl_debug) {
+        gl_debug_report(&renderer->debug, stderr);
+    }
+    funlockfile(stderr);
+}
+
+// Function to handle requests posted by the main thread
+static void handle_requests(Renderer *renderer) {
+    int requests = atomic_exchange(&renderer->requests, 0);
+    if (requests & REQUEST_STOP) {
+        renderer->running = 0;
+    }
+    if (requests & REQUEST_DUMP_STATS) {
+        dump_stats(renderer);
+        publish_summary(renderer, clock_seconds(CLOCK_MONOTONIC));
+    }
+    if (requests & REQUEST_SLEEP) {
+        set_paused(renderer, PAUSE_SLEEP, 1);
+    }
+    if (requests & REQUEST_WAKE) {
+        set_paused(renderer, PAUSE_SLEEP, 0);
+    }
+    if (requests & REQUEST_LOCK) {
+        set_paused(renderer, PAUSE_LOCKED, 1);
+    }
+    if (requests & REQUEST_UNLOCK) {
+        set_paused(renderer, PAUSE_LOCKED, 0);
+    }
+    if (requests & REQUEST_SYNC_PAUSE) {
+        int forwarded = atomic_load(&renderer->forwarded_pause);
+        set_paused(renderer, FORWARDED_PAUSE & forwarded, 1);
+        set_paused(renderer, FORWARDED_PAUSE & ~forwarded, 0);
+    }
+    if (requests & REQUEST_LAYOUT) {
+        update_layout(renderer);
+    }
+    if ((requests & REQUEST_COMPOSITOR) && compositor_refresh(&renderer->compositor, renderer->display)) {
+        update_compositor(renderer);
+    }
+    if (requests & REQUEST_PAUSE) {
+        set_paused(renderer, PAUSE_USER, 1);
+    }
+    if (requests & REQUEST_RESUME) {
+        set_paused(renderer, PAUSE_USER, 0);
+    }
+    if (requests & REQUEST_TRACE) {
+        start_trace(renderer, atomic_load(&renderer->trace_ms));
+    }
+    if (requests & REQUEST_CONFIG) {
+        Config config;
+        pthread_mutex_lock(&renderer->config_lock);
+        config = renderer->pending_config;
+        pthread_mutex_unlock(&renderer->config_lock);
+        apply_config(renderer, &config);
+    }
+}
+
+// Function to handle the wakeup eventfd
+static void on_wake(int fd, uint32_t events, void *user_data) {
+    uint64_t value;
+    if (read(fd, &value, sizeof(value)) == sizeof(value)) {
+        handle_requests(user_data);
+    }
+}
+
+// Function to handle frame timer expirations
+static void on_frame_timer(int fd, uint32_t events, void *user_data) {
+    Renderer *renderer = user_data;
+
+    // Ticks that passed while the previous frame was still being rendered
+    // are dropped rather than rendered in a burst. A stall in the monotonic
+    // clock is treated like a pause, so the animation does not jump.
+    uint64_t missed;
+    animation_clock_skip(renderer->clock, scheduler_tick(&renderer->scheduler, &missed));
+    renderer->frames_missed += missed;
+    if (!renderer->paused) {
+        render_frame(renderer);
+    }
+}
+
+// Function to drain queued X events. Xlib may already have read events into
+// its own queue (also while other outputs of a group wait for replies on the
+// shared connection), so this also runs before every epoll_wait.
+static void process_x_events(Renderer *renderer) {
+    if (!handles_events(renderer)) {
+        return;
+    }
+    while (XPending(renderer->display)) {
+        XEvent event;
+        XNextEvent(renderer->display, &event);
+        switch (event.type) {
+        case VisibilityNotify:
+            set_window_paused(renderer, event.xvisibility.window, PAUSE_HIDDEN,
+                              event.xvisibility.state == VisibilityFullyObscured);
+            break;
+        case UnmapNotify:
+            set_window_paused(renderer, event.xunmap.window, PAUSE_HIDDEN, 1);
+            break;
+        case MapNotify:
+            set_window_paused(renderer, event.xmap.window, PAUSE_HIDDEN, 0);
+            break;
+        case ConfigureNotify:
+            if (event.xconfigure.window == RootWindow(renderer->display, renderer->screen)) {
+                update_layout(renderer);
+                group_post(renderer, REQUEST_LAYOUT);
+            }
+            break;
+        default:
+            if (idle_monitor_handle_event(&renderer->idle, &event)) {
+                set_screen_paused(renderer, PAUSE_SCREENSAVER, renderer->idle.saver_active);
+            } else if (compositor_handle_event(&renderer->compositor, renderer->display, &event)) {
+                update_compositor(renderer);
+                group_post(renderer, REQUEST_COMPOSITOR);
+            }
+            break;
+        }
+    }
+}
+
+// Function to handle the slow DPMS polling timer
+static void on_idle_timer(int fd, uint32_t events, void *user_data) {
+    Renderer *renderer = user_data;
+    uint64_t expirations;
+    if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+        return;
+    }
+    if (idle_monitor_poll(&renderer->idle, renderer->display)) {
+        set_screen_paused(renderer, PAUSE_DPMS, renderer->idle.dpms_off);
+    }
+}
+
+// Function to handle readability of the X connection
+static void on_x_connection(int fd, uint32_t events, void *user_data) {
+    process_x_events(user_data);
+}
+
+// Function to set up the frame timer and epoll set
+static int setup_event_loop(Renderer *renderer) {
+    if (event_loop_init(&renderer->loop) != 0) {
+        return -1;
+    }
+
+    if (scheduler_init(&renderer->scheduler, frame_interval(renderer)) != 0) {
+        return -1;
+    }
+
+    if (event_loop_add(&renderer->loop, renderer->wake_fd, on_wake, renderer) != 0 ||
+        event_loop_add(&renderer->loop, renderer->scheduler.timer_fd, on_frame_timer, renderer) != 0) {
+        fprintf(stderr, "Failed to set up event loop\n");
+        return -1;
+    }
+    if (!handles_events(renderer)) {
+        return 0;
+    }
+
+    // DPMS has no events, so it is polled from a slow timer. The poll is a
+    // single round trip and is skipped entirely if the extension is missing.
+    idle_monitor_init(&renderer->idle, renderer->display, RootWindow(renderer->display, renderer->screen));
+    if (renderer->idle.has_dpms) {
+        renderer->idle_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (renderer->idle_timer_fd < 0) {
+            perror("timerfd_create");
+            return -1;
+        }
+        struct itimerspec spec = {
+            .it_interval = {IDLE_POLL_INTERVAL / 1000000, (IDLE_POLL_INTERVAL % 1000000) * 1000},
+            .it_value = {IDLE_POLL_INTERVAL / 1000000, (IDLE_POLL_INTERVAL % 1000000) * 1000},
+        };
+        timerfd_settime(renderer->idle_timer_fd, 0, &spec, NULL);
+        if (event_loop_add(&renderer->loop, renderer->idle_timer_fd, on_idle_timer, renderer) != 0) {
+            return -1;
+        }
+    }
+
+    if (event_loop_add(&renderer->loop, ConnectionNumber(renderer->display), on_x_connection,
+                       renderer) != 0) {
+        fprintf(stderr, "Failed to set up event loop\n");
+        return -1;
+    }
+    return 0;
+}
+
+// Function to render unpaced frames for a fixed time
+static void bench_loop(Renderer *renderer) {
+    double wall_start = clock_seconds(CLOCK_MONOTONIC);
+    double cpu_start = clock_seconds(CLOCK_THREAD_CPUTIME_ID);
+    double wall_now = wall_start;
+    unsigned long frames = 0;
+
+    // Unpaced frames are expected on every vblank
+    frame_stats_reset(&renderer->stats);
+    perf_counters_reset(&renderer->perf);
+    renderer->present.swap_interval = 1;
+    renderer->present.schedule = 0;
+    if (renderer->energy) {
+        energy_meter_begin(renderer->energy);
+    }
+
+    while (renderer->running && wall_now - wall_start < renderer->options->bench_seconds) {
+        process_x_events(renderer);
+        event_loop_dispatch(&renderer->loop, 0);
+        render_frame(renderer);
+        frames++;
+        wall_now = clock_seconds(CLOCK_MONOTONIC);
+    }
+    if (renderer->energy) {
+        energy_meter_end(renderer->energy);
+    }
+
+    renderer->bench_frames = frames;
+    renderer->bench_wall = wall_now - wall_start;
+    renderer->bench_cpu = clock_seconds(CLOCK_THREAD_CPUTIME_ID) - cpu_start;
+}
+
+// Function to count the live objects of the current context's share group.
+// Names are probed upward until SOAK_GL_GAP in a row are unused, so the count
+// keeps growing with a leak however many names it takes. Queries are not
+// shared and not used outside benchmarks, so they are left out.
+static int count_gl_objects(Renderer *renderer) {
+    int count = 0;
+    for (GLuint name = 1, last_used = 0; name - last_used <= SOAK_GL_GAP; name++) {
+        int used = glIsBuffer(name) + glIsList(name) + glIsTexture(name);
+        if (renderer->use_shaders) {
+            used += glIsProgram(name) + glIsShader(name);
+        }
+        if (used) {
+            count += used;
+            last_used = name;
+        }
+    }
+    return count;
+}
+
+// Function to take a soak sample of the process and the renderer
+static void soak_sample(Renderer *renderer, double elapsed, unsigned long frames, SoakSample *sample) {
+    SeriesSummary frame_time;
+    series_summarize(&renderer->stats.cpu_time, &frame_time);
+    sample->elapsed = elapsed;
+    sample->frames = frames;
+    sample->rss_kb = soak_rss_kb();
+    sample->fds = soak_open_fds();
+    sample->gl_objects = count_gl_objects(renderer);
+    // Also reads what the server has sent since the events were last
+    // handled, so a backlog that handling does not keep up with shows
+    sample->x_queue = XEventsQueued(renderer->display, QueuedAfterReading);
+    sample->frame_p50 = frame_time.p50;
+    sample->frame_p99 = frame_time.p99;
+}
+
+// Function to change the monitor layout and back, rendering a few frames in
+// between, as hotplugging does
+static void soak_change_layout(Renderer *renderer) {
+    int split = renderer->split;
+    renderer->split = split > 0 ? split + 1 : 2;
+    update_layout(renderer);
+    for (int i = 0; i < SOAK_LAYOUT_FRAMES; i++) {
+        render_frame(renderer);
+    }
+    renderer->split = split;
+    update_layout(renderer);
+}
+
+// Function to recreate the window and context. The share group outlives
+// them, so objects the old context did not delete are still counted after,
+// once the new context has rendered a few frames and compiled its programs.
+// Returns the number of objects left behind, or -1 if the window cannot be
+// recreated.
+static int soak_recreate(Renderer *renderer) {
+    int before = count_gl_objects(renderer);
+    destroy_surface(renderer);
+    if (create_surface(renderer) != 0) {
+        fprintf(stderr, "Failed to recreate the window and context\n");
+        return -1;
+    }
+
+    // The new window's presentation timing starts out paced
+    renderer->present.swap_interval = 1;
+    renderer->present.schedule = 0;
+    for (int i = 0; i < SOAK_LAYOUT_FRAMES || (renderer->use_shaders && renderer->shaders.pending > 0); i++) {
+        render_frame(renderer);
+    }
+    int after = count_gl_objects(renderer);
+
+    flockfile(stdout);
+    print_name(renderer, stdout);
+    fprintf(stdout, ": context recreated, GL objects %d -> %d\n", before, after);
+    funlockfile(stdout);
+    return after > before ? after - before : 0;
+}
+
+// Function to run a soak test: render unpaced like a benchmark, sample
+// every interval, change the layout after each sample and recreate the
+// window and context every SOAK_RECREATE_INTERVALS samples, and report the
+// trends at the end. A second context holds the share group for the whole
+// run, so GL objects are counted across recreations. Returns -1 if any
+// metric grows beyond its tolerance or a recreation leaves objects behind.
+static int soak_loop(Renderer *renderer) {
+    const Options *options = renderer->options;
+    renderer->soak_context = glXCreateContext(renderer->display, renderer->visual_info, renderer->glx_context,
+                                              glXIsDirect(renderer->display, renderer->glx_context));
+    if (!renderer->soak_context) {
+        fprintf(stderr, "Failed to create the soak test's share context\n");
+        return -1;
+    }
+
+    SoakLog log = {0};
+    double start = clock_seconds(CLOCK_MONOTONIC);
+    double next_sample = start + options->soak_interval;
+    double now = start;
+    unsigned long frames = 0;
+    int leaked = 0;
+    int status = 0;
+
+    frame_stats_reset(&renderer->stats);
+    renderer->present.swap_interval = 1;
+    renderer->present.schedule = 0;
+
+    while (renderer->running && status == 0 && now - start < options->soak_seconds) {
+        process_x_events(renderer);
+        event_loop_dispatch(&renderer->loop, 0);
+        render_frame(renderer);
+        frames++;
+        now = clock_seconds(CLOCK_MONOTONIC);
+        if (now < next_sample) {
+            continue;
+        }
+
+        SoakSample sample;
+        soak_sample(renderer, now - start, frames, &sample);
+        if (soak_add(&log, &sample) != 0) {
+            fprintf(stderr, "Out of memory for soak samples\n");
+            status = -1;
+        }
+        flockfile(stdout);
+        print_name(renderer, stdout);
+        fprintf(stdout, ": ");
+        soak_print_sample(stdout, &sample);
+        funlockfile(stdout);
+
+        soak_change_layout(renderer);
+        if (log.count % SOAK_RECREATE_INTERVALS == 0) {
+            int count = soak_recreate(renderer);
+            if (count < 0) {
+                status = -1;
+            } else {
+                leaked += count;
+            }
+        }
+
+        // The exercise frames are not part of the next interval
+        frame_stats_reset(&renderer->stats);
+        frames = 0;
+        now = clock_seconds(CLOCK_MONOTONIC);
+        next_sample = now + options->soak_interval;
+    }
+
+    flockfile(stdout);
+    print_name(renderer, stdout);
+    fprintf(stdout, ": ");
+    if (soak_report(stdout, &log) > 0) {
+        status = -1;
+    }
+    if (leaked > 0) {
+        print_name(renderer, stdout);
+        fprintf(stdout, ": context recreation left %d GL object(s) behind\n", leaked);
+        status = -1;
+    }
+    funlockfile(stdout);
+    soak_free(&log);
+    glXDestroyContext(renderer->display, renderer->soak_context);
+    renderer->soak_context = NULL;
+    return status;
+}
+
+// Function to print a string as a JSON string literal
+static void print_json_string(FILE *stream, const char *text) {
+    fputc('"', stream);
+    for (const char *p = text; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            fprintf(stream, "\\%c", *p);
+        } else if ((unsigned char)*p < 0x20) {
+            fprintf(stream, "\\u%04x", *p);
+        } else {
+            fputc(*p, stream);
+        }
+    }
+    fputc('"', stream);
+}
+
+// Function to print a series' summary as flat JSON members, or nulls
+// without samples
+static void print_json_series(FILE *stream, const char *name, const SampleSeries *series) {
+    static const char *fields[] = {"mean", "p50", "p90", "p99", "max"};
+    SeriesSummary summary;
+    series_summarize(series, &summary);
+    double values[] = {summary.mean, summary.p50, summary.p90, summary.p99, summary.max};
+    for (int i = 0; i < 5; i++) {
+        if (summary.count > 0) {
+            fprintf(stream, ",\"%s_%s\":%.4f", name, fields[i], values[i]);
+        } else {
+            fprintf(stream, ",\"%s_%s\":null", name, fields[i]);
+        }
+    }
+}
+
+// Function to print the benchmark report as a single-line JSON object with
+// flat members, for scripts comparing runs. Energy is system-wide, so it is
+// the same on every line and per frame of all renderers' frames.
+static void print_bench_json(Renderer *renderer, FILE *stream, unsigned long all_frames) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    unsigned long frames = renderer->bench_frames;
+    fprintf(stream, "{\"screen\":%d,\"output\":%d,\"monitors\":%d,\"width\":%d,\"height\":%d,\"renderer\":",
+            renderer->screen, renderer->output, renderer->num_screens, renderer->width, renderer->height);
+    print_json_string(stream, renderer->gl_renderer);
+    fprintf(stream, ",\"path\":\"%s\",\"cubes\":%d,\"program\":",
+            renderer->use_display_lists ? "display lists" : "immediate", renderer->cubes);
+    print_json_string(stream, renderer->use_shaders ? shader_manager_active_name(&renderer->shaders) : "fixed function");
+    fprintf(stream, ",\"frames\":%lu,\"seconds\":%.3f,\"fps\":%.2f,\"wall_ms\":%.4f,\"cpu_ms\":%.4f",
+            frames, renderer->bench_wall, frames / renderer->bench_wall,
+            renderer->bench_wall * 1000.0 / frames, renderer->bench_cpu * 1000.0 / frames);
+    print_json_series(stream, "frame_ms", &renderer->stats.cpu_time);
+    print_json_series(stream, "gpu_ms", &renderer->stats.gpu_time);
+    print_json_series(stream, "present_ms", &renderer->stats.present_interval);
+    energy_meter_print_json(stream, renderer->energy, all_frames);
+    perf_counters_print_json(stream, &renderer->perf);
+    fprintf(stream, ",\"first_frame_ms\":%.1f,\"framebuffer_mib\":%.1f,\"rss_kb\":%ld}\n",
+            renderer->first_frame_time * 1000.0, renderer->framebuffer_bytes / (1024.0 * 1024.0),
+            usage.ru_maxrss);
+}
+
+// Function to print the benchmark report of a finished renderer. all_frames
+// is the number of frames of all renderers, which share the energy counters.
+void renderer_print_bench(Renderer *renderer, FILE *stream, unsigned long all_frames) {
+    static const char *bypass_modes[] = {"unset", "requested", "disabled"};
+    unsigned long frames = renderer->bench_frames;
+    double wall = renderer->bench_wall;
+    double cpu = renderer->bench_cpu;
+    if (frames == 0) {
+        return;
+    }
+    if (renderer->options->json) {
+        print_bench_json(renderer, stream, all_frames);
+        return;
+    }
+    print_name(renderer, stream);
+    fprintf(stream, ": %d monitor(s), %dx%d\n", renderer->num_screens, renderer->width, renderer->height);
+    fprintf(stream, "path: %s, %s, %d cube(s) per monitor, renderer: %s\n",
+            renderer->use_display_lists ? "display lists" : "immediate",
+            renderer->use_shaders ? shader_manager_active_name(&renderer->shaders) : "fixed function",
+            renderer->cubes, renderer->gl_renderer);
+    fprintf(stream, "framebuffer: %dx%d, %d samples, %.1f MiB (estimated)\n", renderer->width, renderer->height,
+            renderer->samples, renderer->framebuffer_bytes / (1024.0 * 1024.0));
+    fprintf(stream, "time to first frame: %.1f ms\n", renderer->first_frame_time * 1000.0);
+    if (renderer->use_shaders) {
+        shader_manager_report(&renderer->shaders, stream);
+    }
+    fprintf(stream, "compositor: %s, bypass hint: %s\n", renderer->compositor.active ? "active" : "none",
+            bypass_modes[renderer->options->bypass_compositor]);
+    fprintf(stream, "frames: %lu in %.2fs (%.1f FPS)\n", frames, wall, frames / wall);
+    fprintf(stream, "frame time: %.3f ms wall, %.3f ms CPU\n", wall * 1000.0 / frames, cpu * 1000.0 / frames);
+    if (renderer->present.refresh_rate > 0) {
+        fprintf(stream, "refresh rate: %.2f Hz\n", renderer->present.refresh_rate);
+    }
+    frame_stats_print(stream, &renderer->stats);
+    perf_counters_print(stream, &renderer->perf);
+    if (renderer->options->gl_debug) {
+        gl_debug_report(&renderer->debug, stream);
+    }
+}
+
+// Function to handle main rendering loop
+static void main_loop(Renderer *renderer) {
+    // Start paused if the saver is already running or monitors are off
+    scheduler_start(&renderer->scheduler);
+    set_screen_paused(renderer, PAUSE_SCREENSAVER, renderer->idle.saver_active);
+    set_screen_paused(renderer, PAUSE_DPMS, renderer->idle.dpms_off);
+    while (renderer->running) {
+        process_x_events(renderer);
+        XFlush(renderer->display);
+        PROBE2(sleep_start, renderer->screen, renderer->output);
+        int status = event_loop_dispatch(&renderer->loop, -1);
+        PROBE2(sleep_end, renderer->screen, renderer->output);
+        if (status < 0) {
+            break;
+        }
+    }
+}
+
+// Function to run the renderer: set up X11 and OpenGL on this thread, then
+// render until asked to stop
+static void *renderer_thread(void *user_data) {
+    Renderer *renderer = user_data;
+    renderer->status = -1;
+    renderer->init_start = clock_seconds(CLOCK_MONOTONIC);
+    if (renderer->group) {
+        renderer->clock = &renderer->group->clock;
+    } else {
+        animation_clock_init(&renderer->own_clock, 1, clock_seconds(CLOCK_MONOTONIC));
+        renderer->clock = &renderer->own_clock;
+    }
+    pthread_mutex_lock(&renderer->config_lock);
+    renderer->config = renderer->pending_config;
+    pthread_mutex_unlock(&renderer->config_lock);
+
+    if (initialize(renderer) == 0 && setup_event_loop(renderer) == 0) {
+        // Startup uploads are not part of any frame, so counting starts here
+        if (renderer->options->instrument) {
+            gl_instrument_attach(&renderer->gl_counters);
+        }
+        // Counters follow the thread that opens them
+        if (renderer->options->perf_counters) {
+            perf_counters_open(&renderer->perf);
+        }
+        renderer->running = 1;
+        handle_requests(renderer);
+        renderer->status = 0;
+        if (renderer->options->soak_seconds > 0) {
+            renderer->status = soak_loop(renderer);
+        } else if (renderer->options->bench_seconds > 0) {
+            bench_loop(renderer);
+        } else {
+            main_loop(renderer);
+        }
+    } else {
+        fprintf(stderr, "Initialization failed on screen %d\n", renderer->screen);
+        if (renderer->group && renderer->output == 0) {
+            group_set_ready(renderer->group, -1);
+        }
+    }
+    cleanup(renderer);
+    if (!renderer->group) {
+        animation_clock_destroy(&renderer->own_clock);
+    }
+
+    // Let the main thread know this renderer is done
+    uint64_t one = 1;
+    if (write(renderer->exit_fd, &one, sizeof(one)) != sizeof(one)) {
+        perror("write");
+    }
+    return NULL;
+}
+
+// Function to prepare a renderer for an X screen. Nothing is opened on the
+// X server until the renderer thread starts.
+int renderer_create(Renderer *renderer, const Options *options, int screen, int exit_fd) {
+    memset(renderer, 0, sizeof(*renderer));
+    renderer->options = options;
+    renderer->screen = screen;
+    renderer->split = options->split;
+    renderer->exit_fd = exit_fd;
+    renderer->loop.epoll_fd = -1;
+    renderer->scheduler.timer_fd = -1;
+    renderer->idle_timer_fd = -1;
+    renderer->perf.leader = -1;
+    atomic_init(&renderer->requests, 0);
+    atomic_init(&renderer->forwarded_pause, 0);
+    atomic_init(&renderer->trace_ms, 0);
+    pthread_mutex_init(&renderer->config_lock, NULL);
+    pthread_mutex_init(&renderer->summary_lock, NULL);
+    config_defaults(&renderer->pending_config);
+    gl_debug_init(&renderer->debug);
+
+    renderer->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (renderer->wake_fd < 0) {
+        perror("eventfd");
+        return -1;
+    }
+    return 0;
+}
+
+// Function to hand a new configuration to the renderer. It is applied on
+// the renderer thread before the next frame.
+void renderer_set_config(Renderer *renderer, const Config *config) {
+    pthread_mutex_lock(&renderer->config_lock);
+    renderer->pending_config = *config;
+    pthread_mutex_unlock(&renderer->config_lock);
+    renderer_post(renderer, REQUEST_CONFIG);
+}
+
+// Function to make the renderer record a frame trace for the given time
+void renderer_trace(Renderer *renderer, int milliseconds) {
+    atomic_store(&renderer->trace_ms, milliseconds);
+    renderer_post(renderer, REQUEST_TRACE);
+}
+
+// Function to get the summary the renderer last published. Safe to call
+// from any thread.
+void renderer_summary(Renderer *renderer, RendererSummary *summary) {
+    pthread_mutex_lock(&renderer->summary_lock);
+    *summary = renderer->summary;
+    pthread_mutex_unlock(&renderer->summary_lock);
+}
+
+// Function to make the renderer draw a single output of a group
+void renderer_set_group(Renderer *renderer, OutputGroup *group, int output) {
+    renderer->group = group;
+    renderer->output = output;
+    group->members[output] = renderer;
+}
+
+// Function to start the renderer thread
+int renderer_start(Renderer *renderer) {
+    if (pthread_create(&renderer->thread, NULL, renderer_thread, renderer) != 0) {
+        fprintf(stderr, "Failed to start renderer for screen %d\n", renderer->screen);
+        return -1;
+    }
+    renderer->started = 1;
+    return 0;
+}
+
+// Function to post a request to the renderer thread. Safe to call from any
+// thread; the request is handled between frames.
+void renderer_post(Renderer *renderer, int request) {
+    atomic_fetch_or(&renderer->requests, request);
+    uint64_t one = 1;
+    if (write(renderer->wake_fd, &one, sizeof(one)) != sizeof(one)) {
+        perror("write");
+    }
+}
+
+// Function to wait for the renderer thread to finish
+void renderer_join(Renderer *renderer) {
+    if (renderer->started) {
+        pthread_join(renderer->thread, NULL);
+        renderer->started = 0;
+    }
+}
+
+// Function to release what renderer_create allocated
+void renderer_destroy(Renderer *renderer) {
+    if (renderer->wake_fd >= 0) close(renderer->wake_fd);
+    renderer->wake_fd = -1;
+    pthread_mutex_destroy(&renderer->config_lock);
+    pthread_mutex_destroy(&renderer->summary_lock);
+    gl_debug_destroy(&renderer->debug);
+}
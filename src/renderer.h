@@ -0,0 +1,236 @@
+/**
+ * Per-X-screen renderer.
+ *
+ * Each renderer owns its own X connection, desktop window, GLX context and
+ * event loop, and runs on its own thread with independent frame pacing. The
+ * main thread talks to it only through posted requests. With
+ * --thread-per-output, each monitor of an X screen gets its own renderer
+ * instead, and the renderers of a screen form an output group.
+ */
+
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include <GL/glew.h>
+#include <GL/glx.h>
+
+#include <X11/Xlib.h>
+#include <X11/extensions/Xinerama.h>
+
+#include "animation_clock.h"
+#include "compositor.h"
+#include "config.h"
+#include "energy.h"
+#include "event_loop.h"
+#include "frame_stats.h"
+#include "gl_debug.h"
+#include "gl_instrument.h"
+#include "gl_record.h"
+#include "gl_state.h"
+#include "gpu_timer.h"
+#include "idle.h"
+#include "perf_counters.h"
+#include "present.h"
+#include "shader_manager.h"
+#include "scheduler.h"
+#include "soak.h"
+
+// Command line options shared by all renderers
+typedef struct {
+    int screen;  // X screen to render on, -1 for all
+    int use_display_lists;
+    int use_shaders;
+    int cubes;   // Instanced cubes per monitor on the GLSL path, 1 by default
+    int no_state_cache;
+    int instrument;  // Count GL calls and driver time per frame
+    int gl_debug;    // Debug context, driver performance messages
+    int perf_counters;  // CPU performance counters per frame
+    int schedule_msc;
+    int late_latch;
+    int bypass_compositor;
+    int thread_per_output;
+    int split;   // Divide each screen into this many virtual outputs, 0 to disable
+    double bench_seconds;
+    int json;    // Benchmark report as one JSON object per renderer
+    const char *record_path;  // GL command stream of the first renderer, for tools/gl_replay
+    unsigned long record_frames;
+    double soak_seconds;    // Soak test duration, 0 to disable
+    double soak_interval;   // Seconds between soak samples
+} Options;
+
+typedef struct Renderer Renderer;
+
+// Outputs of one X screen rendered by separate threads. They share the X
+// connection, a GL share group holding the geometry, and the animation clock.
+// Only the leader (output 0) reads X events; it forwards what concerns the
+// other outputs as requests.
+typedef struct {
+    Display *display;
+    int screen;
+    int num_outputs;
+    Renderer **members;
+    AnimationClock clock;
+
+    // Set up by the leader (output 0), waited for by the other outputs
+    pthread_mutex_t lock;
+    pthread_cond_t ready_cond;
+    int ready;   // 1 once shared objects exist, -1 if the leader failed
+    GLXContext share_context;
+    GLsync ready_fence;
+    GLuint vertex_buffer;
+    GLuint index_buffer;
+    GLuint color_buffer;
+    GLuint cube_list;
+} OutputGroup;
+
+// Requests posted to a renderer, handled on its thread between frames
+enum {
+    REQUEST_STOP = 1 << 0,
+    REQUEST_DUMP_STATS = 1 << 1,
+    REQUEST_SLEEP = 1 << 2,
+    REQUEST_WAKE = 1 << 3,
+    REQUEST_SYNC_PAUSE = 1 << 4,   // Apply pause reasons forwarded by the group leader
+    REQUEST_LAYOUT = 1 << 5,       // Monitor layout changed
+    REQUEST_COMPOSITOR = 1 << 6,   // Compositor started or stopped
+    REQUEST_CONFIG = 1 << 7,       // New configuration in pending_config
+    REQUEST_PAUSE = 1 << 8,        // Paused from the control socket
+    REQUEST_RESUME = 1 << 9,
+    REQUEST_TRACE = 1 << 10,       // Record a frame trace for trace_ms
+    REQUEST_LOCK = 1 << 11,        // Session locked
+    REQUEST_UNLOCK = 1 << 12,
+};
+
+// What a renderer last published about itself, for the control socket
+typedef struct {
+    unsigned long frames;
+    unsigned long missed;
+    unsigned long pauses;
+    int paused;
+    double frame_p50;   // Frame CPU time over the sample window, ms
+    double frame_p99;
+} RendererSummary;
+
+struct Renderer {
+    const Options *options;
+    int screen;
+    OutputGroup *group;  // NULL unless rendering a single output of a group
+    int output;
+    pthread_t thread;
+    int started;
+    int wake_fd;        // eventfd the thread waits on for requests
+    int exit_fd;        // eventfd signalled when the thread finishes
+    atomic_int requests;
+    atomic_int forwarded_pause;
+    atomic_int trace_ms;
+    int status;
+
+    // Configuration in use, and the next one handed over by the main thread
+    Config config;
+    pthread_mutex_t config_lock;
+    Config pending_config;
+
+    // Summary read by the main thread, refreshed about once a second
+    pthread_mutex_t summary_lock;
+    RendererSummary summary;
+    double summary_time;
+
+    // X11 and GLX objects, owned by the renderer thread
+    Display *display;
+    Window window;
+    int window_x;
+    int window_y;
+    XineramaScreenInfo *screen_info;
+    XVisualInfo *visual_info;
+    GLXContext glx_context;
+    GLXContext soak_context;    // Keeps the share group alive across context recreation in soak runs
+    Colormap color_map;
+    GLuint vertex_buffer;
+    GLuint index_buffer;
+    GLuint color_buffer;
+    GLuint cube_list;
+    GLuint screen_lists;
+    int num_screen_lists;
+    int use_shaders;    // GLSL path active, programs come from `shaders`
+    int cubes;          // Drawn per monitor, more than 1 only when instanced
+    ShaderManager shaders;
+    GlState gl;         // Tracks the context's state to filter redundant calls
+    GlCounters gl_counters;  // Current frame's GL calls, with --instrument
+    GlDebug debug;      // Driver performance messages, with --gl-debug
+    int record;         // Records its GL calls, with --record
+    GlRecorder recorder;
+    int num_screens;
+    int split;          // As --split, changed by soak runs to exercise layout changes
+    int width;
+    int height;
+    int samples;        // Of the chosen visual, 0 without multisampling
+    double framebuffer_bytes;  // Estimated size of the window's buffers
+
+    // Rendering profile
+    int target_fps;
+    int low_cost;
+    int use_display_lists;
+    char gl_renderer[128];
+
+    // Event loop state
+    EventLoop loop;
+    int idle_timer_fd;
+    int running;
+    int paused;
+    FrameScheduler scheduler;
+    IdleMonitor idle;
+    CompositorMonitor compositor;
+
+    // Animation clock (own or shared with the group) and pause accounting
+    AnimationClock own_clock;
+    AnimationClock *clock;
+    double paused_since;
+    double paused_total;
+    double rotation_phase;  // Angle offset keeping the cube still on speed changes
+
+    // Presentation feedback and frame timing
+    PresentTiming present;
+    FrameStats stats;
+    PerfCounters perf;      // With --perf-counters
+    GpuTimer gpu_timer;     // In benchmarks
+    double predicted_present;
+    double render_latency;
+    unsigned long frames_rendered;
+    unsigned long frames_missed;
+    unsigned long pause_count;
+
+    // Frame trace requested from the control socket
+    FILE *trace;
+    double trace_end;
+    char trace_path[256];
+
+    // Seconds from thread start to the first frame
+    double init_start;
+    double first_frame_time;
+
+    // Benchmark totals, and the system's energy counters if readable
+    EnergyMeter *energy;
+    unsigned long bench_frames;
+    double bench_wall;
+    double bench_cpu;
+};
+
+int query_monitors(Display *display, int screen, int split, XineramaScreenInfo **monitors);
+
+int output_group_init(OutputGroup *group, Display *display, int screen, int num_outputs);
+void output_group_destroy(OutputGroup *group);
+
+int renderer_create(Renderer *renderer, const Options *options, int screen, int exit_fd);
+void renderer_set_group(Renderer *renderer, OutputGroup *group, int output);
+void renderer_set_config(Renderer *renderer, const Config *config);
+void renderer_trace(Renderer *renderer, int milliseconds);
+void renderer_summary(Renderer *renderer, RendererSummary *summary);
+int renderer_start(Renderer *renderer);
+void renderer_post(Renderer *renderer, int request);
+void renderer_join(Renderer *renderer);
+void renderer_print_bench(Renderer *renderer, FILE *stream, unsigned long all_frames);
+void renderer_destroy(Renderer *renderer);
+
+#endif
@@ -0,0 +1,119 @@
+/**
+ * Frame scheduler, see scheduler.h.
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/timerfd.h>
+
+#include "scheduler.h"
+
+// Monotonic time beyond the frame interval that counts as a stall
+#define GAP_THRESHOLD 0.25
+
+// Growth of CLOCK_BOOTTIME over CLOCK_MONOTONIC that counts as a suspend
+#define SUSPEND_THRESHOLD 0.1
+
+// Function to read a clock in seconds
+double clock_seconds(clockid_t clock_id) {
+    struct timespec now;
+    clock_gettime(clock_id, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// Function to sample both clocks as the new reference point
+static void scheduler_sample(FrameScheduler *scheduler) {
+    double monotonic = clock_seconds(CLOCK_MONOTONIC);
+    scheduler->last_monotonic = monotonic;
+    scheduler->last_boot_offset = clock_seconds(CLOCK_BOOTTIME) - monotonic;
+}
+
+// Function to create the frame timer
+int scheduler_init(FrameScheduler *scheduler, long interval_us) {
+    scheduler->interval_us = interval_us;
+    scheduler->running = 0;
+    scheduler->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (scheduler->timer_fd < 0) {
+        perror("timerfd_create");
+        return -1;
+    }
+    scheduler_sample(scheduler);
+    return 0;
+}
+
+// Function to (re)arm the timer with the first deadline one interval from
+// now. Any previous phase and pending expirations are discarded.
+void scheduler_start(FrameScheduler *scheduler) {
+    struct itimerspec spec = {0};
+    spec.it_interval.tv_sec = scheduler->interval_us / 1000000;
+    spec.it_interval.tv_nsec = (scheduler->interval_us % 1000000) * 1000;
+    spec.it_value = spec.it_interval;
+    timerfd_settime(scheduler->timer_fd, 0, &spec, NULL);
+    scheduler_sample(scheduler);
+    scheduler->running = 1;
+}
+
+// Function to disarm the timer
+void scheduler_stop(FrameScheduler *scheduler) {
+    struct itimerspec spec = {0};
+    timerfd_settime(scheduler->timer_fd, 0, &spec, NULL);
+    scheduler->running = 0;
+}
+
+// Function to change the frame interval, taking effect immediately
+void scheduler_set_interval(FrameScheduler *scheduler, long interval_us) {
+    scheduler->interval_us = interval_us;
+    if (scheduler->running) {
+        scheduler_start(scheduler);
+    }
+}
+
+// Function to consume a timer expiration. Stores the number of skipped
+// deadlines in `missed` and returns the length in seconds of a discontinuity
+// in CLOCK_MONOTONIC (0 if none), so the caller can keep it out of the
+// animation. Time spent in system suspend does not advance CLOCK_MONOTONIC;
+// it is detected via CLOCK_BOOTTIME and only counted.
+double scheduler_tick(FrameScheduler *scheduler, uint64_t *missed) {
+    uint64_t expirations = 0;
+    *missed = 0;
+    if (read(scheduler->timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+        return 0.0;
+    }
+
+    double monotonic = clock_seconds(CLOCK_MONOTONIC);
+    double boot_offset = clock_seconds(CLOCK_BOOTTIME) - monotonic;
+    double suspended = boot_offset - scheduler->last_boot_offset;
+    double gap = monotonic - scheduler->last_monotonic - scheduler->interval_us / 1e6;
+    scheduler->last_monotonic = monotonic;
+    scheduler->last_boot_offset = boot_offset;
+
+    if (suspended > SUSPEND_THRESHOLD) {
+        scheduler->suspends++;
+        scheduler->suspend_time += suspended;
+    }
+    if (gap > GAP_THRESHOLD) {
+        // Restart the phase from now instead of counting the stall as
+        // missed frames
+        scheduler->gaps++;
+        scheduler->gap_time += gap;
+        scheduler_start(scheduler);
+        return gap;
+    }
+    if (suspended > SUSPEND_THRESHOLD) {
+        scheduler_start(scheduler);
+        return 0.0;
+    }
+
+    *missed = expirations - 1;
+    return 0.0;
+}
+
+// Function to close the frame timer
+void scheduler_destroy(FrameScheduler *scheduler) {
+    if (scheduler->timer_fd >= 0) {
+        close(scheduler->timer_fd);
+    }
+    scheduler->timer_fd = -1;
+}
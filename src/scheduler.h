@@ -0,0 +1,40 @@
+/**
+ * Frame scheduler.
+ *
+ * Paces frames with a periodic timerfd and detects discontinuities (system
+ * suspend, SIGSTOP, long stalls) so that the loop resets its deadlines
+ * instead of rendering a catch-up burst.
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+#include <time.h>
+
+typedef struct {
+    int timer_fd;
+    long interval_us;
+    int running;
+
+    // Clock samples from the previous tick
+    double last_monotonic;
+    double last_boot_offset;
+
+    // Discontinuity counters
+    unsigned long gaps;
+    unsigned long suspends;
+    double gap_time;
+    double suspend_time;
+} FrameScheduler;
+
+double clock_seconds(clockid_t clock_id);
+
+int scheduler_init(FrameScheduler *scheduler, long interval_us);
+void scheduler_start(FrameScheduler *scheduler);
+void scheduler_stop(FrameScheduler *scheduler);
+void scheduler_set_interval(FrameScheduler *scheduler, long interval_us);
+double scheduler_tick(FrameScheduler *scheduler, uint64_t *missed);
+void scheduler_destroy(FrameScheduler *scheduler);
+
+#endif
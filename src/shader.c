@@ -0,0 +1,151 @@
+/**
+ * GLSL programs for the optional shader render path, see shader.h.
+ */
+
+#include <stdio.h>
+
+#include "shader.h"
+
+// Places each instance of an instanced draw in its cell of a grid x grid x
+// grid lattice filling the cube's volume, in instance order. Without the
+// uniform set (0) or instancing, the vertex stays where it is.
+#define INSTANCE_VERTEX \
+    "#extension GL_ARB_draw_instanced : enable\n" \
+    "uniform float grid;\n" \
+    "vec4 instance_vertex() {\n" \
+    "    float side = max(grid, 1.0);\n" \
+    "#ifdef GL_ARB_draw_instanced\n" \
+    "    float id = float(gl_InstanceIDARB);\n" \
+    "#else\n" \
+    "    float id = 0.0;\n" \
+    "#endif\n" \
+    "    float row = floor((id + 0.5) / side);\n" \
+    "    float layer = floor((row + 0.5) / side);\n" \
+    "    vec3 cell = vec3(id - row * side, row - layer * side, layer);\n" \
+    "    float scale = side > 1.0 ? 0.7 : 1.0;\n" \
+    "    return vec4((cell * 2.0 - (side - 1.0) + gl_Vertex.xyz * scale) / side, 1.0);\n" \
+    "}\n"
+
+// GLSL 1.20 keeps access to the fixed-function matrices and vertex arrays,
+// so the same buffers and display lists feed both paths
+static const char flat_vertex_shader[] =
+    "#version 120\n"
+    INSTANCE_VERTEX
+    "varying vec4 color;\n"
+    "void main() {\n"
+    "    color = gl_Color;\n"
+    "    gl_Position = gl_ModelViewProjectionMatrix * instance_vertex();\n"
+    "}\n";
+
+static const char flat_fragment_shader[] =
+    "#version 120\n"
+    "varying vec4 color;\n"
+    "void main() {\n"
+    "    gl_FragColor = color;\n"
+    "}\n";
+
+// Headlight diffuse shading, with face normals from screen-space derivatives
+// since the cube has no normal attribute
+static const char lit_vertex_shader[] =
+    "#version 120\n"
+    INSTANCE_VERTEX
+    "varying vec4 color;\n"
+    "varying vec3 position;\n"
+    "void main() {\n"
+    "    vec4 vertex = instance_vertex();\n"
+    "    color = gl_Color;\n"
+    "    position = vec3(gl_ModelViewMatrix * vertex);\n"
+    "    gl_Position = gl_ModelViewProjectionMatrix * vertex;\n"
+    "}\n";
+
+static const char lit_fragment_shader[] =
+    "#version 120\n"
+    "varying vec4 color;\n"
+    "varying vec3 position;\n"
+    "void main() {\n"
+    "    vec3 normal = normalize(cross(dFdx(position), dFdy(position)));\n"
+    "    float diffuse = abs(dot(normal, normalize(position)));\n"
+    "    gl_FragColor = vec4(color.rgb * (0.35 + 0.65 * diffuse), color.a);\n"
+    "}\n";
+
+const ShaderVariant shader_variants[] = {
+    {"flat", flat_vertex_shader, flat_fragment_shader},
+    {"lit", lit_vertex_shader, lit_fragment_shader},
+};
+const int num_shader_variants = sizeof(shader_variants) / sizeof(shader_variants[0]);
+
+// Function to print a shader or program info log
+static void print_info_log(GLuint object, int is_program, const char *what) {
+    char log[1024];
+    GLsizei length = 0;
+    if (is_program) {
+        glGetProgramInfoLog(object, sizeof(log), &length, log);
+    } else {
+        glGetShaderInfoLog(object, sizeof(log), &length, log);
+    }
+    fprintf(stderr, "Failed to %s:\n%.*s\n", what, (int)length, log);
+}
+
+// Function to submit one shader stage for compilation
+static GLuint compile_shader(GLenum type, const char *source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    return shader;
+}
+
+// Function to submit a program for compiling and linking without waiting
+// for the result; with GL_KHR_parallel_shader_compile the driver works on it
+// in the background until the status is queried. With `retrievable`, the
+// driver is asked to keep the binary for glGetProgramBinary().
+GLuint shader_begin_program(const char *vertex_source, const char *fragment_source, int retrievable) {
+    GLuint vertex = compile_shader(GL_VERTEX_SHADER, vertex_source);
+    GLuint fragment = compile_shader(GL_FRAGMENT_SHADER, fragment_source);
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertex);
+    glAttachShader(program, fragment);
+    if (retrievable) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glLinkProgram(program);
+
+    // Flagged for deletion, they go away with the program
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+    return program;
+}
+
+// Function to wait for a program submitted with shader_begin_program() and
+// check it. Logs the errors and deletes the program if it failed. Returns 0
+// on failure.
+GLuint shader_finish_program(GLuint program) {
+    if (shader_link_status(program)) {
+        return program;
+    }
+    GLuint shaders[2];
+    GLsizei count = 0;
+    glGetAttachedShaders(program, 2, &count, shaders);
+    for (int i = 0; i < count; i++) {
+        GLint status;
+        glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &status);
+        if (!status) {
+            print_info_log(shaders[i], 0, "compile shader");
+        }
+    }
+    print_info_log(program, 1, "link program");
+    glDeleteProgram(program);
+    return 0;
+}
+
+// Function to compile and link a program, waiting for the result. Returns
+// 0 on failure.
+GLuint shader_compile_program(const char *vertex_source, const char *fragment_source, int retrievable) {
+    return shader_finish_program(shader_begin_program(vertex_source, fragment_source, retrievable));
+}
+
+// Function to check whether a program linked (or loaded) successfully
+int shader_link_status(GLuint program) {
+    GLint status = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    return status == GL_TRUE;
+}
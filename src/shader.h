@@ -0,0 +1,29 @@
+/**
+ * GLSL programs for the optional shader render path.
+ *
+ * The shaders use the fixed-function inputs (per-vertex colors, the matrix
+ * stack set up by the renderer), so they work with both the buffer and the
+ * display list paths. Variants are ordered from cheapest to best looking;
+ * "flat" matches the fixed-function output.
+ */
+
+#ifndef SHADER_H
+#define SHADER_H
+
+#include <GL/glew.h>
+
+typedef struct {
+    const char *name;
+    const char *vertex_source;
+    const char *fragment_source;
+} ShaderVariant;
+
+extern const ShaderVariant shader_variants[];
+extern const int num_shader_variants;
+
+GLuint shader_begin_program(const char *vertex_source, const char *fragment_source, int retrievable);
+GLuint shader_finish_program(GLuint program);
+GLuint shader_compile_program(const char *vertex_source, const char *fragment_source, int retrievable);
+int shader_link_status(GLuint program);
+
+#endif
@@ -0,0 +1,147 @@
+/**
+ * Deferred compilation of the shader variants, see shader_manager.h.
+ */
+
+#include <string.h>
+#include <time.h>
+
+#include "scheduler.h"
+#include "shader.h"
+#include "shader_manager.h"
+
+// Function to pick the best ready variant. Returns 1 if it changed.
+static int select_active(ShaderManager *manager) {
+    int active = -1;
+    for (int i = 0; i < num_shader_variants && i < MAX_SHADER_VARIANTS; i++) {
+        if (manager->programs[i].state == PROGRAM_READY) {
+            active = i;
+        }
+    }
+    if (active == manager->active) {
+        return 0;
+    }
+    manager->active = active;
+    return 1;
+}
+
+// Function to load every variant from the program cache, and submit the
+// others for compilation without waiting for them
+void shader_manager_start(ShaderManager *manager) {
+    memset(manager, 0, sizeof(*manager));
+    manager->active = -1;
+    manager->start_time = clock_seconds(CLOCK_MONOTONIC);
+
+    // Let the driver use as many compiler threads as it sees fit
+    if (GLEW_KHR_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+        manager->parallel = 1;
+    } else if (GLEW_ARB_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+        manager->parallel = 1;
+    }
+    program_cache_open(&manager->cache);
+
+    for (int i = 0; i < num_shader_variants && i < MAX_SHADER_VARIANTS; i++) {
+        const ShaderVariant *variant = &shader_variants[i];
+        ManagedProgram *program = &manager->programs[i];
+        program->program = program_cache_load(&manager->cache, variant->vertex_source, variant->fragment_source);
+        if (program->program) {
+            program->state = PROGRAM_READY;
+            program->cached = 1;
+            program->ready_time = clock_seconds(CLOCK_MONOTONIC) - manager->start_time;
+        } else {
+            program->submit_time = clock_seconds(CLOCK_MONOTONIC);
+            program->program = shader_begin_program(variant->vertex_source, variant->fragment_source,
+                                                    manager->cache.available);
+            program->compile_time = clock_seconds(CLOCK_MONOTONIC) - program->submit_time;
+            program->state = PROGRAM_PENDING;
+            manager->pending++;
+        }
+    }
+    select_active(manager);
+}
+
+// Function to check on the programs still compiling. Without background
+// compilation, checking a program waits for it, so only one is finished per
+// call to spread the stalls over several frames. Returns 1 if the program to
+// use changed.
+int shader_manager_poll(ShaderManager *manager) {
+    for (int i = 0; manager->pending > 0 && i < num_shader_variants && i < MAX_SHADER_VARIANTS; i++) {
+        ManagedProgram *program = &manager->programs[i];
+        if (program->state != PROGRAM_PENDING) {
+            continue;
+        }
+        if (manager->parallel) {
+            GLint complete = GL_FALSE;
+            glGetProgramiv(program->program, GL_COMPLETION_STATUS_KHR, &complete);
+            if (!complete) {
+                continue;
+            }
+        }
+
+        // The compile time is what submitting and finishing took on this
+        // thread, without the frames rendered in between. In the background
+        // it runs from the program's own submission to the poll that finds
+        // it complete, so it can be up to a frame too long.
+        const ShaderVariant *variant = &shader_variants[i];
+        double finish_start = clock_seconds(CLOCK_MONOTONIC);
+        program->program = shader_finish_program(program->program);
+        double now = clock_seconds(CLOCK_MONOTONIC);
+        if (manager->parallel) {
+            program->compile_time = now - program->submit_time;
+        } else {
+            program->compile_time += now - finish_start;
+        }
+        program->ready_time = now - manager->start_time;
+        program->state = program->program ? PROGRAM_READY : PROGRAM_FAILED;
+        manager->pending--;
+        if (program->program) {
+            program_cache_store(&manager->cache, variant->vertex_source, variant->fragment_source,
+                                program->program, program->compile_time);
+        }
+        if (!manager->parallel) {
+            break;
+        }
+    }
+    return select_active(manager);
+}
+
+// Function to get the program to draw with, 0 for the fixed-function
+// pipeline
+GLuint shader_manager_program(const ShaderManager *manager) {
+    return manager->active >= 0 ? manager->programs[manager->active].program : 0;
+}
+
+// Function to get the name of the variant in use
+const char *shader_manager_active_name(const ShaderManager *manager) {
+    return manager->active >= 0 ? shader_variants[manager->active].name : "fixed function";
+}
+
+// Function to print when each variant became ready, and the cache results
+void shader_manager_report(const ShaderManager *manager, FILE *stream) {
+    fprintf(stream, "programs (%s compile):", manager->parallel ? "parallel" : "serial");
+    for (int i = 0; i < num_shader_variants && i < MAX_SHADER_VARIANTS; i++) {
+        const ManagedProgram *program = &manager->programs[i];
+        if (program->state == PROGRAM_PENDING) {
+            fprintf(stream, " %s pending,", shader_variants[i].name);
+        } else {
+            fprintf(stream, " %s %s after %.1f ms%s,", shader_variants[i].name,
+                    program->state == PROGRAM_READY ? "ready" : "failed", program->ready_time * 1000.0,
+                    program->cached ? " (cached)" : "");
+        }
+    }
+    fprintf(stream, " using %s\n", shader_manager_active_name(manager));
+    program_cache_report(&manager->cache, stream);
+}
+
+// Function to delete all programs
+void shader_manager_destroy(ShaderManager *manager) {
+    for (int i = 0; i < num_shader_variants && i < MAX_SHADER_VARIANTS; i++) {
+        if (manager->programs[i].program) {
+            glDeleteProgram(manager->programs[i].program);
+            manager->programs[i].program = 0;
+        }
+    }
+    manager->pending = 0;
+    manager->active = -1;
+}
@@ -0,0 +1,54 @@
+/**
+ * Deferred compilation of the shader variants.
+ *
+ * All variants are submitted at startup and polled for completion between
+ * frames. With GL_KHR_parallel_shader_compile (or the ARB version) the
+ * driver compiles them on its own threads and polling never blocks. Until a
+ * program is ready the renderer draws with the best one that is (the
+ * fixed-function pipeline if none is), so the time to the first frame does
+ * not grow with the number of variants. Cached binaries are ready at once.
+ */
+
+#ifndef SHADER_MANAGER_H
+#define SHADER_MANAGER_H
+
+#include <stdio.h>
+
+#include <GL/glew.h>
+
+#include "program_cache.h"
+
+#define MAX_SHADER_VARIANTS 8
+
+enum {
+    PROGRAM_PENDING,
+    PROGRAM_READY,
+    PROGRAM_FAILED,
+};
+
+typedef struct {
+    GLuint program;
+    int state;
+    int cached;         // Loaded from the program cache
+    double ready_time;  // Seconds from submission to being usable
+    double submit_time; // When it was submitted, on the monotonic clock
+    double compile_time;    // Seconds the compile and link took, see shader_manager_poll()
+} ManagedProgram;
+
+typedef struct {
+    int parallel;       // Driver compiles in the background
+    ProgramCache cache;
+    ManagedProgram programs[MAX_SHADER_VARIANTS];
+    int pending;
+    int active;         // Variant in use, -1 for the fixed-function pipeline
+    double start_time;
+} ShaderManager;
+
+void shader_manager_start(ShaderManager *manager);
+int shader_manager_poll(ShaderManager *manager);
+GLuint shader_manager_program(const ShaderManager *manager);
+const char *shader_manager_active_name(const ShaderManager *manager);
+void shader_manager_report(const ShaderManager *manager, FILE *stream);
+void shader_manager_destroy(ShaderManager *manager);
+
+#endif
@@ -0,0 +1,149 @@
+/**
+ * logind PrepareForSleep and LockedHint listener, see sleep_monitor.h.
+ *
+ * Built against sd-bus when HAVE_LIBSYSTEMD is defined; otherwise the default
+ * ops report the monitor as unavailable and the frame scheduler's clock gap
+ * detection alone handles resume.
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "sleep_monitor.h"
+
+#ifdef HAVE_LIBSYSTEMD
+#include <systemd/sd-bus.h>
+
+static int on_prepare_for_sleep(sd_bus_message *message, void *user_data, sd_bus_error *error) {
+    SleepMonitor *monitor = user_data;
+    int start;
+    if (sd_bus_message_read(message, "b", &start) >= 0) {
+        monitor->sleeping = start;
+    }
+    return 0;
+}
+
+// Object path of the session, resolved once since property changes are
+// signalled on the real path and not on the "auto" alias
+static char *session_path;
+
+// Function to read the session's LockedHint
+static void read_locked_hint(SleepMonitor *monitor, sd_bus *bus) {
+    int locked;
+    if (sd_bus_get_property_trivial(bus, "org.freedesktop.login1", session_path, "org.freedesktop.login1.Session",
+                                    "LockedHint", NULL, 'b', &locked) >= 0) {
+        monitor->locked = locked;
+    }
+}
+
+static int on_session_changed(sd_bus_message *message, void *user_data, sd_bus_error *error) {
+    read_locked_hint(user_data, sd_bus_message_get_bus(message));
+    return 0;
+}
+
+// Function to follow the LockedHint of our session. For a process outside
+// any session, such as a user service, "auto" is the user's display session.
+static void watch_session(SleepMonitor *monitor, sd_bus *bus) {
+    char *id = NULL;
+    if (sd_bus_get_property_string(bus, "org.freedesktop.login1", "/org/freedesktop/login1/session/auto",
+                                   "org.freedesktop.login1.Session", "Id", NULL, &id) < 0) {
+        return;
+    }
+    int status = sd_bus_path_encode("/org/freedesktop/login1/session", id, &session_path);
+    free(id);
+    if (status < 0) {
+        return;
+    }
+    if (sd_bus_match_signal(bus, NULL, "org.freedesktop.login1", session_path, "org.freedesktop.DBus.Properties",
+                            "PropertiesChanged", on_session_changed, monitor) < 0) {
+        free(session_path);
+        session_path = NULL;
+        return;
+    }
+    read_locked_hint(monitor, bus);
+}
+
+static int logind_open(SleepMonitor *monitor) {
+    sd_bus *bus = NULL;
+    if (sd_bus_open_system(&bus) < 0) {
+        return -1;
+    }
+    if (sd_bus_match_signal(bus, NULL, "org.freedesktop.login1", "/org/freedesktop/login1",
+                            "org.freedesktop.login1.Manager", "PrepareForSleep", on_prepare_for_sleep,
+                            monitor) < 0) {
+        sd_bus_unref(bus);
+        return -1;
+    }
+
+    // Lock awareness is optional, sleep notifications work without it
+    watch_session(monitor, bus);
+    monitor->connection = bus;
+    return sd_bus_get_fd(bus);
+}
+
+static int logind_dispatch(SleepMonitor *monitor) {
+    int was_sleeping = monitor->sleeping;
+    int was_locked = monitor->locked;
+    while (sd_bus_process(monitor->connection, NULL) > 0) {
+    }
+    return monitor->sleeping != was_sleeping || monitor->locked != was_locked;
+}
+
+static void logind_close(SleepMonitor *monitor) {
+    sd_bus_flush_close_unref(monitor->connection);
+    free(session_path);
+    session_path = NULL;
+}
+#else
+static int logind_open(SleepMonitor *monitor) {
+    (void)monitor;
+    return -1;
+}
+
+static int logind_dispatch(SleepMonitor *monitor) {
+    (void)monitor;
+    return 0;
+}
+
+static void logind_close(SleepMonitor *monitor) {
+    (void)monitor;
+}
+#endif
+
+static const SleepMonitorOps logind_ops = {
+    .open = logind_open,
+    .dispatch = logind_dispatch,
+    .close = logind_close,
+};
+
+static const SleepMonitorOps *current_ops = &logind_ops;
+
+// Function to replace the D-Bus backend (NULL restores the default)
+void sleep_monitor_set_ops(const SleepMonitorOps *ops) {
+    current_ops = ops ? ops : &logind_ops;
+}
+
+// Function to connect the monitor. Returns a pollable fd, or -1 if sleep
+// notifications are unavailable.
+int sleep_monitor_open(SleepMonitor *monitor) {
+    monitor->ops = current_ops;
+    monitor->connection = NULL;
+    monitor->sleeping = 0;
+    monitor->locked = 0;
+    monitor->fd = monitor->ops->open(monitor);
+    return monitor->fd;
+}
+
+// Function to process input on the monitor fd. Returns 1 if the sleeping
+// or locked state changed.
+int sleep_monitor_dispatch(SleepMonitor *monitor) {
+    return monitor->ops->dispatch(monitor);
+}
+
+// Function to disconnect the monitor
+void sleep_monitor_close(SleepMonitor *monitor) {
+    if (monitor->ops && monitor->fd >= 0) {
+        monitor->ops->close(monitor);
+    }
+    monitor->fd = -1;
+}
@@ -0,0 +1,35 @@
+/**
+ * Notification of imminent system sleep (logind PrepareForSleep) and of the
+ * session being locked (the session's LockedHint, set by the screen locker).
+ *
+ * The D-Bus side sits behind a small ops table so that it can be replaced,
+ * e.g. by a pipe-driven stub in tests, via sleep_monitor_set_ops().
+ */
+
+#ifndef SLEEP_MONITOR_H
+#define SLEEP_MONITOR_H
+
+typedef struct SleepMonitor SleepMonitor;
+
+typedef struct {
+    // Connect and subscribe; returns a pollable fd or -1 if unavailable
+    int (*open)(SleepMonitor *monitor);
+    // Process pending input; returns 1 if the sleeping or locked state changed
+    int (*dispatch)(SleepMonitor *monitor);
+    void (*close)(SleepMonitor *monitor);
+} SleepMonitorOps;
+
+struct SleepMonitor {
+    const SleepMonitorOps *ops;
+    void *connection;
+    int fd;
+    int sleeping;
+    int locked;
+};
+
+void sleep_monitor_set_ops(const SleepMonitorOps *ops);
+int sleep_monitor_open(SleepMonitor *monitor);
+int sleep_monitor_dispatch(SleepMonitor *monitor);
+void sleep_monitor_close(SleepMonitor *monitor);
+
+#endif
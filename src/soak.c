@@ -0,0 +1,163 @@
+/**
+ * Soak test sampling and trend detection, see soak.h.
+ */
+
+#include <dirent.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "soak.h"
+
+// Samples needed for a trend: the startup sample, which is left out, and
+// three more
+#define SOAK_MIN_SAMPLES 4
+
+// A metric fails if its growth over the run exceeds the larger of the
+// relative tolerance (of its value at the start) and the absolute one
+typedef struct {
+    const char *name;
+    size_t offset;
+    double relative;
+    double absolute;
+} SoakMetric;
+
+static const SoakMetric soak_metrics[] = {
+    {"rss_kb", offsetof(SoakSample, rss_kb), 0.05, 2048.0},
+    {"fds", offsetof(SoakSample, fds), 0.0, 0.5},
+    {"gl_objects", offsetof(SoakSample, gl_objects), 0.0, 0.5},
+    {"x_queue", offsetof(SoakSample, x_queue), 0.0, 64.0},
+    {"frame_p50_ms", offsetof(SoakSample, frame_p50), 0.10, 0.05},
+    {"frame_p99_ms", offsetof(SoakSample, frame_p99), 0.25, 0.25},
+};
+
+#define NUM_SOAK_METRICS (int)(sizeof(soak_metrics) / sizeof(soak_metrics[0]))
+
+// Function to get the resident memory of the process in KiB, or -1
+long soak_rss_kb(void) {
+    FILE *file = fopen("/proc/self/statm", "r");
+    if (!file) {
+        return -1;
+    }
+    long size, resident;
+    int fields = fscanf(file, "%ld %ld", &size, &resident);
+    fclose(file);
+    return fields == 2 ? resident * (sysconf(_SC_PAGESIZE) / 1024) : -1;
+}
+
+// Function to count the open file descriptors of the process, or -1
+int soak_open_fds(void) {
+    DIR *directory = opendir("/proc/self/fd");
+    if (!directory) {
+        return -1;
+    }
+    int count = 0;
+    struct dirent *entry;
+    while ((entry = readdir(directory))) {
+        if (entry->d_name[0] != '.') {
+            count++;
+        }
+    }
+    closedir(directory);
+
+    // Not counting the directory's own descriptor
+    return count - 1;
+}
+
+// Function to append a sample. Returns -1 if out of memory.
+int soak_add(SoakLog *log, const SoakSample *sample) {
+    if (log->count == log->capacity) {
+        int capacity = log->capacity ? log->capacity * 2 : 256;
+        SoakSample *samples = realloc(log->samples, capacity * sizeof(*samples));
+        if (!samples) {
+            return -1;
+        }
+        log->samples = samples;
+        log->capacity = capacity;
+    }
+    log->samples[log->count++] = *sample;
+    return 0;
+}
+
+// Function to print one sample as it is taken
+void soak_print_sample(FILE *stream, const SoakSample *sample) {
+    fprintf(stream, "soak %8.0fs: %lu frames, rss %.0f KiB, %.0f fds, %.0f GL objects, %.0f queued events, "
+            "frame p50 %.3f p99 %.3f ms\n", sample->elapsed, sample->frames, sample->rss_kb, sample->fds,
+            sample->gl_objects, sample->x_queue, sample->frame_p50, sample->frame_p99);
+    fflush(stream);
+}
+
+// Function to get a metric of a sample
+static double metric_value(const SoakSample *sample, const SoakMetric *metric) {
+    return *(const double *)((const char *)sample + metric->offset);
+}
+
+// Function to fit a line to a metric over elapsed time, by least squares
+static void fit_trend(const SoakSample *samples, int count, const SoakMetric *metric, double *slope,
+                      double *intercept) {
+    double mean_t = 0.0, mean_v = 0.0;
+    for (int i = 0; i < count; i++) {
+        mean_t += samples[i].elapsed;
+        mean_v += metric_value(&samples[i], metric);
+    }
+    mean_t /= count;
+    mean_v /= count;
+    double covariance = 0.0, variance = 0.0;
+    for (int i = 0; i < count; i++) {
+        double dt = samples[i].elapsed - mean_t;
+        covariance += dt * (metric_value(&samples[i], metric) - mean_v);
+        variance += dt * dt;
+    }
+    *slope = variance > 0.0 ? covariance / variance : 0.0;
+    *intercept = mean_v - *slope * mean_t;
+}
+
+// Function to print the trend of every metric. Returns the number of
+// metrics growing beyond their tolerance.
+int soak_report(FILE *stream, const SoakLog *log) {
+    if (log->count < SOAK_MIN_SAMPLES) {
+        fprintf(stream, "soak: %d samples, too few for trends (at least %d needed)\n", log->count,
+                SOAK_MIN_SAMPLES);
+        return 0;
+    }
+
+    // The first interval includes startup and is left out
+    const SoakSample *samples = log->samples + 1;
+    int count = log->count - 1;
+    double first = samples[0].elapsed;
+    double span = samples[count - 1].elapsed - first;
+    fprintf(stream, "soak: %d samples over %.2f h\n", count, span / 3600.0);
+    fprintf(stream, "%-14s %12s %12s %12s %12s %12s\n", "metric", "start", "end", "trend/h", "growth", "limit");
+
+    int growing = 0;
+    for (int i = 0; i < NUM_SOAK_METRICS; i++) {
+        const SoakMetric *metric = &soak_metrics[i];
+        double slope, intercept;
+        fit_trend(samples, count, metric, &slope, &intercept);
+        double start = intercept + slope * first;
+        double growth = slope * span;
+        double limit = metric->relative * (start > 0.0 ? start : 0.0);
+        if (limit < metric->absolute) {
+            limit = metric->absolute;
+        }
+        int failed = growth > limit;
+        growing += failed;
+        fprintf(stream, "%-14s %12.3f %12.3f %12.3f %12.3f %12.3f  %s\n", metric->name,
+                metric_value(&samples[0], metric), metric_value(&samples[count - 1], metric), slope * 3600.0,
+                growth, limit, failed ? "GROWING" : "ok");
+    }
+    if (growing) {
+        fprintf(stream, "soak: FAILED, %d metrics growing\n", growing);
+    } else {
+        fprintf(stream, "soak: passed\n");
+    }
+    return growing;
+}
+
+// Function to free the samples
+void soak_free(SoakLog *log) {
+    free(log->samples);
+    log->samples = NULL;
+    log->count = 0;
+    log->capacity = 0;
+}
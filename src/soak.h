@@ -0,0 +1,41 @@
+/**
+ * Soak test sampling and trend detection.
+ *
+ * A soak run renders unpaced for hours and takes a sample of the process
+ * and the renderer every interval. At the end each metric gets a least
+ * squares trend over the run, leaving out the first sample (startup); a
+ * metric whose trend adds up to more than its tolerance over the run is
+ * reported as growing. Slow leaks and drift that a short benchmark cannot
+ * see show up this way.
+ */
+
+#ifndef SOAK_H
+#define SOAK_H
+
+#include <stdio.h>
+
+typedef struct {
+    double elapsed;         // Seconds since the soak run started
+    unsigned long frames;   // Rendered in the interval
+    double rss_kb;          // Resident memory of the process
+    double fds;             // Open file descriptors of the process
+    double gl_objects;      // Live GL objects of the share group
+    double x_queue;         // X events read but not yet handled
+    double frame_p50;       // Frame CPU time over the interval, ms
+    double frame_p99;
+} SoakSample;
+
+typedef struct {
+    SoakSample *samples;
+    int count;
+    int capacity;
+} SoakLog;
+
+long soak_rss_kb(void);
+int soak_open_fds(void);
+int soak_add(SoakLog *log, const SoakSample *sample);
+void soak_print_sample(FILE *stream, const SoakSample *sample);
+int soak_report(FILE *stream, const SoakLog *log);
+void soak_free(SoakLog *log);
+
+#endif
@@ -0,0 +1,68 @@
+/**
+ * Matrix and animation math, see transform.h.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "transform.h"
+
+// Function to build a perspective projection, as gluPerspective() does.
+// `fovy` is the vertical field of view in degrees.
+void matrix_perspective(float matrix[16], float fovy, float aspect, float near, float far) {
+    float f = 1.0f / tanf(fovy * (float)M_PI / 360.0f);
+    memset(matrix, 0, 16 * sizeof(float));
+    matrix[0] = f / aspect;
+    matrix[5] = f;
+    matrix[10] = (far + near) / (near - far);
+    matrix[11] = -1.0f;
+    matrix[14] = 2.0f * far * near / (near - far);
+}
+
+// Function to normalize a vector in place
+static void normalize(float v[3]) {
+    float length = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    if (length > 0.0f) {
+        v[0] /= length;
+        v[1] /= length;
+        v[2] /= length;
+    }
+}
+
+// Function to compute the cross product a x b
+static void cross(const float a[3], const float b[3], float result[3]) {
+    result[0] = a[1] * b[2] - a[2] * b[1];
+    result[1] = a[2] * b[0] - a[0] * b[2];
+    result[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+// Function to build a camera transform, as gluLookAt() does
+void matrix_look_at(float matrix[16], const float eye[3], const float center[3], const float up[3]) {
+    float forward[3] = {center[0] - eye[0], center[1] - eye[1], center[2] - eye[2]};
+    normalize(forward);
+    float side[3];
+    cross(forward, up, side);
+    normalize(side);
+    float true_up[3];
+    cross(side, forward, true_up);
+
+    for (int i = 0; i < 3; i++) {
+        matrix[i * 4 + 0] = side[i];
+        matrix[i * 4 + 1] = true_up[i];
+        matrix[i * 4 + 2] = -forward[i];
+        matrix[i * 4 + 3] = 0.0f;
+    }
+    // Translation by -eye, rotated into the camera frame
+    matrix[12] = -(side[0] * eye[0] + side[1] * eye[1] + side[2] * eye[2]);
+    matrix[13] = -(true_up[0] * eye[0] + true_up[1] * eye[1] + true_up[2] * eye[2]);
+    matrix[14] = forward[0] * eye[0] + forward[1] * eye[1] + forward[2] * eye[2];
+    matrix[15] = 1.0f;
+}
+
+// Function to compute the cube's rotation angles in degrees after `seconds`
+// of animation at `speed` degrees per second, offset by `phase`
+void rotation_angles(double phase, double speed, double seconds, float *angle_x, float *angle_y) {
+    double angle = phase + speed * seconds;
+    *angle_x = fmod(angle, 360.0);
+    *angle_y = fmod(angle, 360.0);
+}
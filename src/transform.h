@@ -0,0 +1,15 @@
+/**
+ * Matrix and animation math for the per-frame view setup.
+ *
+ * Matrices are column-major, as glLoadMatrixf() expects. The functions are
+ * free of GL calls, so they can be timed on their own (tools/bench_micro.c).
+ */
+
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+void matrix_perspective(float matrix[16], float fovy, float aspect, float near, float far);
+void matrix_look_at(float matrix[16], const float eye[3], const float center[3], const float up[3]);
+void rotation_angles(double phase, double speed, double seconds, float *angle_x, float *angle_y);
+
+#endif
@@ -0,0 +1,100 @@
+#!/bin/sh
+# Compare benchmark suite results against a baseline and flag regressions.
+# Both files hold one flat JSON object per line, as written by
+# bench_suite.sh; lines are matched by scene, screen and output.
+#
+# Usage: tools/bench_compare.sh BASELINE RESULTS [METRIC=PERCENT ...]
+#
+# A metric regresses when it gets worse by more than its threshold, in
+# percent of the baseline. Thresholds can be overridden or added per metric,
+# e.g. frame_ms_p99=25. Metrics missing (or null) on either side are
+# skipped. Exits with 1 if anything regressed.
+
+if [ $# -lt 2 ]; then
+    echo "Usage: $0 BASELINE RESULTS [METRIC=PERCENT ...]" >&2
+    exit 2
+fi
+BASELINE=$1
+RESULTS=$2
+shift 2
+
+# Metric, direction (+ if higher is worse, - if lower is worse), threshold
+THRESHOLDS="
+frame_ms_p50 + 10
+frame_ms_p99 + 20
+cpu_ms + 10
+gpu_ms_p50 + 10
+fps - 10
+first_frame_ms + 25
+rss_kb + 20
+energy_package_mj_per_frame + 10
+ipc - 10
+$(for override in "$@"; do echo "${override%%=*} ? ${override#*=}"; done)
+"
+
+awk -v thresholds="$THRESHOLDS" '
+# Function to split a flat JSON object into values[key]
+function parse(line, values,    pair, key, value) {
+    split("", values)
+    gsub(/^[ \t]*\{|\}[ \t]*$/, "", line)
+    while (match(line, /"[^"]*":("([^"\\]|\\.)*"|[^,]*)/)) {
+        pair = substr(line, RSTART, RLENGTH)
+        line = substr(line, RSTART + RLENGTH)
+        key = pair
+        sub(/":.*/, "", key)
+        sub(/^"/, "", key)
+        value = pair
+        sub(/^"[^"]*":/, "", value)
+        gsub(/^"|"$/, "", value)
+        values[key] = value
+    }
+}
+
+BEGIN {
+    count = split(thresholds, lines, "\n")
+    for (i = 1; i <= count; i++) {
+        if (split(lines[i], fields, " ") != 3) continue
+        if (!(fields[1] in limit)) order[++metrics] = fields[1]
+        if (fields[2] != "?") direction[fields[1]] = fields[2]
+        else if (!(fields[1] in direction)) direction[fields[1]] = "+"
+        limit[fields[1]] = fields[3]
+    }
+}
+
+FNR == NR {
+    parse($0, values)
+    id = values["scene"] "/" values["screen"] "/" values["output"]
+    for (key in values) baseline[id, key] = values[key]
+    known[id] = 1
+    next
+}
+
+{
+    parse($0, values)
+    id = values["scene"] "/" values["screen"] "/" values["output"]
+    if (!(id in known)) {
+        printf "%-28s not in baseline\n", id
+        next
+    }
+    for (i = 1; i <= metrics; i++) {
+        metric = order[i]
+        if (!((id, metric) in baseline) || !(metric in values)) continue
+        old = baseline[id, metric]
+        new = values[metric]
+        if (old == "null" || new == "null" || old + 0 == 0) continue
+        change = (new - old) * 100 / old
+        worse = direction[metric] == "+" ? change : -change
+        flag = worse > limit[metric] ? "REGRESSION" : (worse < -limit[metric] ? "improved" : "")
+        printf "%-28s %-16s %12.3f -> %12.3f %+7.1f%% %s\n", id, metric, old, new, change, flag
+        if (flag == "REGRESSION") regressions++
+    }
+}
+
+END {
+    if (regressions) {
+        printf "%d regression(s)\n", regressions
+        exit 1
+    }
+    print "no regressions"
+}
+' "$BASELINE" "$RESULTS"
@@ -0,0 +1,149 @@
+#!/bin/sh
+# Benchmark and check rendering on synthetic monitor layouts, without the
+# monitors. Each layout runs in its own Xvfb server, with the monitors
+# defined as RandR 1.5 monitors (which Xvfb reports through Xinerama), so
+# layouts can be stacked, L-shaped or mix sizes and DPIs. While the
+# benchmark runs, the root window is read back: the center of every monitor
+# must show the cube and its corner the background.
+#
+# Usage: tools/bench_layouts.sh [SECONDS] [extra desktop_cube options]
+#
+# Needs Xvfb, xrandr, xdpyinfo, xwd and ImageMagick. Prints one line per
+# layout: outputs, mean frame time, estimated framebuffer memory and the
+# readback result (monitors correct / total).
+
+BINARY=${BINARY:-./build/desktop_cube}
+DURATION=${1:-5}
+[ $# -gt 0 ] && shift
+OPTIONS="$*"
+DISPLAY_NUMBER=${DISPLAY_NUMBER:-97}
+
+# Layouts: name, then monitors as WIDTHxHEIGHT+X+Y[@DPI] (96 DPI by default)
+LAYOUTS='
+single       1920x1080+0+0
+side-2       1920x1080+0+0 1920x1080+1920+0
+side-4       1280x720+0+0 1280x720+1280+0 1280x720+2560+0 1280x720+3840+0
+side-8       960x540+0+0 960x540+960+0 960x540+1920+0 960x540+2880+0 960x540+3840+0 960x540+4800+0 960x540+5760+0 960x540+6720+0
+stacked-2    1920x1080+0+0 1920x1080+0+1080
+grid-4       1280x720+0+0 1280x720+1280+0 1280x720+0+720 1280x720+1280+720
+l-shape-3    1920x1080+0+0 1920x1080+1920+0 1920x1080+0+1080
+portrait-3   1920x1080+0+420 1080x1920+1920+0 1920x1080+3000+420
+mixed-dpi-2  3840x2160+0+0@163 1920x1080+3840+540@92
+mixed-dpi-3  2560x1440+0+0@109 3840x2160+2560+0@163 1280x1024+6400+0@96
+'
+
+# Background of the default configuration (nord0)
+BACKGROUND="46,52,64"
+
+if command -v magick >/dev/null 2>&1; then
+    CONVERT="magick"
+else
+    CONVERT="convert"
+fi
+for tool in Xvfb xrandr xdpyinfo xwd "$CONVERT"; do
+    if ! command -v "$tool" >/dev/null 2>&1; then
+        echo "$tool not found" >&2
+        exit 1
+    fi
+done
+
+# Known colors and settings, whatever the user's config file says
+WORK=$(mktemp -d)
+trap 'kill "$XVFB" 2>/dev/null; rm -rf "$WORK"' EXIT
+trap 'exit 130' INT
+trap 'exit 143' TERM
+mkdir -p "$WORK/config" "$WORK/runtime"
+chmod 700 "$WORK/runtime"
+export XDG_CONFIG_HOME="$WORK/config" XDG_RUNTIME_DIR="$WORK/runtime"
+
+# Measure rendering cost, not the refresh rate
+export vblank_mode=0
+
+# Function to print a pixel of the screenshot as "r,g,b"
+pixel() {
+    "$CONVERT" "$WORK/root.xwd" -format "%[fx:int(255*p{$1,$2}.r+0.5)],%[fx:int(255*p{$1,$2}.g+0.5)],%[fx:int(255*p{$1,$2}.b+0.5)]" info:
+}
+
+# Function to run one layout: start Xvfb, define the monitors, benchmark and
+# read back
+run_layout() {
+    name=$1
+    shift
+
+    # The X screen is the bounding box of the monitors
+    width=0
+    height=0
+    for monitor in "$@"; do
+        geometry=${monitor%@*}
+        w=${geometry%%x*}; rest=${geometry#*x}
+        h=${rest%%+*}; rest=${rest#*+}
+        x=${rest%%+*}; y=${rest#*+}
+        [ $((x + w)) -gt "$width" ] && width=$((x + w))
+        [ $((y + h)) -gt "$height" ] && height=$((y + h))
+    done
+
+    Xvfb ":$DISPLAY_NUMBER" -screen 0 "${width}x${height}x24" -nolisten tcp </dev/null >/dev/null 2>&1 &
+    XVFB=$!
+    export DISPLAY=":$DISPLAY_NUMBER"
+    tries=0
+    until xdpyinfo >/dev/null 2>&1; do
+        tries=$((tries + 1))
+        if [ "$tries" -gt 50 ]; then
+            echo "$name: Xvfb did not start" >&2
+            kill "$XVFB" 2>/dev/null
+            return
+        fi
+        sleep 0.1
+    done
+
+    # The first monitor takes over Xvfb's output, so its default monitor
+    # covering the whole screen goes away
+    index=0
+    output=screen
+    for monitor in "$@"; do
+        geometry=${monitor%@*}
+        dpi=96
+        [ "$geometry" != "$monitor" ] && dpi=${monitor#*@}
+        w=${geometry%%x*}; rest=${geometry#*x}
+        h=${rest%%+*}; rest=${rest#*+}
+        xrandr --setmonitor "bench-$index" "$w/$((w * 254 / dpi / 10))x$h/$((h * 254 / dpi / 10))+$rest" "$output"
+        index=$((index + 1))
+        output=none
+    done
+
+    # shellcheck disable=SC2086
+    "$BINARY" --bench "$DURATION" $OPTIONS </dev/null >"$WORK/bench.txt" 2>"$WORK/stderr.txt" &
+    bench=$!
+
+    # Read back halfway through, once the first frames are certainly out
+    sleep "$(awk "BEGIN { print $DURATION / 2 }")"
+    xwd -root -silent >"$WORK/root.xwd"
+    correct=0
+    for monitor in "$@"; do
+        geometry=${monitor%@*}
+        w=${geometry%%x*}; rest=${geometry#*x}
+        h=${rest%%+*}; rest=${rest#*+}
+        x=${rest%%+*}; y=${rest#*+}
+        center=$(pixel $((x + w / 2)) $((y + h / 2)))
+        corner=$(pixel $((x + 2)) $((y + 2)))
+        if [ "$center" != "$BACKGROUND" ] && [ "$corner" = "$BACKGROUND" ]; then
+            correct=$((correct + 1))
+        fi
+    done
+    wait "$bench"
+
+    frame=$(awk '/^frame time:/ { print $3 }' "$WORK/bench.txt")
+    memory=$(awk '/^framebuffer:/ { print $5 }' "$WORK/bench.txt")
+    printf '%-12s %7d %12s %12s %6d/%d\n' "$name" "$#" "${frame:--}" "${memory:--}" "$correct" "$#"
+
+    kill "$XVFB" 2>/dev/null
+    wait "$XVFB" 2>/dev/null
+}
+
+printf '%-12s %7s %12s %12s %8s\n' layout outputs "frame (ms)" "fb (MiB)" readback
+while read -r name monitors; do
+    # shellcheck disable=SC2086
+    [ -n "$name" ] && run_layout "$name" $monitors
+done <<EOF
+$LAYOUTS
+EOF
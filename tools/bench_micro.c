@@ -0,0 +1,264 @@
+/**
+ * bench_micro: time the CPU-side kernels of the frame loop in isolation.
+ *
+ * Usage: bench_micro [-r REPETITIONS] [-w WARMUP] [-c CPU] [KERNEL...]
+ *
+ * Every kernel is calibrated to run for about a millisecond per repetition,
+ * warmed up, then timed for the given number of repetitions. The report
+ * gives nanoseconds per call over the repetitions. Pin to a CPU (and use
+ * the performance governor) for stable numbers. No display is needed.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <limits.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../src/config.h"
+#include "../src/frame_stats.h"
+#include "../src/layout.h"
+#include "../src/scheduler.h"
+#include "../src/transform.h"
+
+#define STAGING_CUBES 1024
+#define VERTICES_PER_CUBE 8
+
+// Position and color of a vertex, interleaved as a buffer would hold them
+typedef struct {
+    float position[3];
+    float color[4];
+} PackedVertex;
+
+typedef struct {
+    const char *name;
+    void (*run)(unsigned long iterations);
+} Kernel;
+
+// Keeps the compiler from dropping results that are never used
+#define KEEP(pointer) __asm__ volatile("" : : "r"(pointer) : "memory")
+
+static const float cube_vertices[VERTICES_PER_CUBE][3] = {
+    {-1.0f, -1.0f, 1.0f}, {1.0f, -1.0f, 1.0f}, {1.0f, -1.0f, -1.0f}, {-1.0f, -1.0f, -1.0f},
+    {-1.0f, 1.0f, 1.0f}, {1.0f, 1.0f, 1.0f}, {1.0f, 1.0f, -1.0f}, {-1.0f, 1.0f, -1.0f},
+};
+
+static Config config;
+static PackedVertex staging[STAGING_CUBES * VERTICES_PER_CUBE] __attribute__((aligned(64)));
+static PackedVertex buffer[STAGING_CUBES * VERTICES_PER_CUBE] __attribute__((aligned(64)));
+
+// Function to build a projection and camera matrix, as every screen pass
+// without display lists does
+static void run_matrices(unsigned long iterations) {
+    static const float center[3] = {0.0f, 0.0f, 0.0f};
+    static const float up[3] = {0.0f, 1.0f, 0.0f};
+    float projection[16], view[16];
+    for (unsigned long i = 0; i < iterations; i++) {
+        matrix_perspective(projection, 50.0f, 16.0f / 9.0f + i * 1e-9f, 0.1f, 10.0f);
+        matrix_look_at(view, config.camera, center, up);
+        KEEP(projection);
+        KEEP(view);
+    }
+}
+
+// Function to update the rotation angles, once per frame
+static void run_rotation(unsigned long iterations) {
+    float angle_x, angle_y;
+    for (unsigned long i = 0; i < iterations; i++) {
+        rotation_angles(12.5, config.rotation_speed, i / 60.0, &angle_x, &angle_y);
+        KEEP(&angle_x);
+        KEEP(&angle_y);
+    }
+}
+
+// Function to compute the window size of an 8-monitor layout, as on every
+// layout change
+static void run_layout(unsigned long iterations) {
+    XineramaScreenInfo monitors[8];
+    for (int i = 0; i < 8; i++) {
+        monitors[i] = (XineramaScreenInfo){i, (i % 4) * 1920, (i / 4) * 1080, 1920, 1080};
+    }
+    int width, height;
+    for (unsigned long i = 0; i < iterations; i++) {
+        KEEP(monitors);
+        layout_bounds(monitors, 8, &width, &height);
+        KEEP(&width);
+        KEEP(&height);
+    }
+}
+
+// Function to expand the configured colors to the cube's vertices, as on
+// every color change
+static void run_vertex_colors(unsigned long iterations) {
+    float colors[VERTICES_PER_CUBE][4];
+    for (unsigned long i = 0; i < iterations; i++) {
+        config_vertex_colors(&config, colors, VERTICES_PER_CUBE);
+        KEEP(colors);
+    }
+}
+
+// Function to pack positions and colors of many cubes into an interleaved
+// staging buffer
+static void run_packing(unsigned long iterations) {
+    float colors[VERTICES_PER_CUBE][4];
+    config_vertex_colors(&config, colors, VERTICES_PER_CUBE);
+    for (unsigned long i = 0; i < iterations; i++) {
+        for (int cube = 0; cube < STAGING_CUBES; cube++) {
+            PackedVertex *vertex = &staging[cube * VERTICES_PER_CUBE];
+            for (int v = 0; v < VERTICES_PER_CUBE; v++) {
+                memcpy(vertex[v].position, cube_vertices[v], sizeof(vertex[v].position));
+                memcpy(vertex[v].color, colors[v], sizeof(vertex[v].color));
+            }
+        }
+        KEEP(staging);
+    }
+}
+
+// Function to copy the staging buffer to its destination, which is what a
+// buffer upload costs the CPU with a mapped or driver-side copy
+static void run_upload(unsigned long iterations) {
+    for (unsigned long i = 0; i < iterations; i++) {
+        KEEP(staging);
+        memcpy(buffer, staging, sizeof(buffer));
+        KEEP(buffer);
+    }
+}
+
+static const Kernel kernels[] = {
+    {"matrices", run_matrices},
+    {"rotation", run_rotation},
+    {"layout", run_layout},
+    {"vertex_colors", run_vertex_colors},
+    {"packing", run_packing},
+    {"upload", run_upload},
+};
+
+#define NUM_KERNELS (int)(sizeof(kernels) / sizeof(kernels[0]))
+
+// Function to time one repetition of a kernel, in seconds
+static double time_kernel(const Kernel *kernel, unsigned long iterations) {
+    double start = clock_seconds(CLOCK_MONOTONIC);
+    kernel->run(iterations);
+    return clock_seconds(CLOCK_MONOTONIC) - start;
+}
+
+// Function to find the iteration count that takes about a millisecond
+static unsigned long calibrate(const Kernel *kernel) {
+    unsigned long iterations = 1;
+    while (iterations < (1UL << 30) && time_kernel(kernel, iterations) < 1e-3) {
+        iterations *= 2;
+    }
+    return iterations;
+}
+
+// Function to calibrate, warm up and time a kernel, then print its summary
+static void bench_kernel(const Kernel *kernel, int repetitions, int warmup) {
+    static SampleSeries series;
+    memset(&series, 0, sizeof(series));
+    unsigned long iterations = calibrate(kernel);
+    for (int i = 0; i < warmup; i++) {
+        time_kernel(kernel, iterations);
+    }
+    for (int i = 0; i < repetitions; i++) {
+        series_add(&series, time_kernel(kernel, iterations) * 1e9 / iterations);
+    }
+
+    SeriesSummary summary;
+    series_summarize(&series, &summary);
+    printf("%-14s %10.2f %10.2f %10.2f %10.2f %9.1f%% %10lu\n", kernel->name, summary.mean, summary.p50,
+           summary.p99, summary.max, summary.mean > 0 ? 100.0 * summary.stddev / summary.mean : 0.0, iterations);
+}
+
+// Function to print command line usage
+static void usage(const char *program) {
+    fprintf(stderr, "Usage: %s [-r REPETITIONS] [-w WARMUP] [-c CPU] [KERNEL...]\nKernels:", program);
+    for (int i = 0; i < NUM_KERNELS; i++) {
+        fprintf(stderr, " %s", kernels[i].name);
+    }
+    fprintf(stderr, "\n");
+}
+
+// Function to parse a whole option argument as an integer in the given
+// range. Returns -1 with a message if it is not one.
+static int parse_option(int option, const char *text, int minimum, int maximum, int *value) {
+    char *end;
+    errno = 0;
+    long number = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || errno == ERANGE || number < minimum || number > maximum) {
+        fprintf(stderr, "Invalid -%c value '%s', must be %d to %d\n", option, text, minimum, maximum);
+        return -1;
+    }
+    *value = (int)number;
+    return 0;
+}
+
+// Function to find a kernel by name. Returns -1 if there is none.
+static int find_kernel(const char *name) {
+    for (int i = 0; i < NUM_KERNELS; i++) {
+        if (strcmp(name, kernels[i].name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int main(int argc, char **argv) {
+    int repetitions = 50;
+    int warmup = 5;
+    int cpu = -1;
+    int option;
+    while ((option = getopt(argc, argv, "r:w:c:h")) != -1) {
+        switch (option) {
+        case 'r':
+            if (parse_option(option, optarg, 1, SAMPLE_WINDOW, &repetitions) != 0) exit(EXIT_FAILURE);
+            break;
+        case 'w':
+            if (parse_option(option, optarg, 0, INT_MAX, &warmup) != 0) exit(EXIT_FAILURE);
+            break;
+        case 'c':
+            if (parse_option(option, optarg, 0, CPU_SETSIZE - 1, &cpu) != 0) exit(EXIT_FAILURE);
+            break;
+        default:
+            usage(argv[0]);
+            exit(option == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+    for (int arg = optind; arg < argc; arg++) {
+        if (find_kernel(argv[arg]) < 0) {
+            fprintf(stderr, "Unknown kernel '%s'\n", argv[arg]);
+            usage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Pinning keeps migrations and frequency differences between cores out
+    // of the numbers
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+            perror("sched_setaffinity");
+            exit(EXIT_FAILURE);
+        }
+    }
+    config_defaults(&config);
+
+    printf("%-14s %10s %10s %10s %10s %10s %10s\n", "kernel", "mean ns", "p50 ns", "p99 ns", "max ns", "cv",
+           "iterations");
+    for (int i = 0; i < NUM_KERNELS; i++) {
+        int selected = optind == argc;
+        for (int arg = optind; arg < argc; arg++) {
+            selected |= find_kernel(argv[arg]) == i;
+        }
+        if (selected) {
+            bench_kernel(&kernels[i], repetitions, warmup);
+        }
+    }
+    return 0;
+}
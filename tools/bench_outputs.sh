@@ -0,0 +1,20 @@
+#!/bin/sh
+# Benchmark how rendering scales with the number of outputs, drawn by a
+# single thread and by one thread per output. The screen is split into 1 to 6
+# virtual monitors so the comparison works with any real monitor setup.
+#
+# Usage: tools/bench_outputs.sh [SECONDS] [extra desktop_cube options]
+
+BINARY=${BINARY:-./build/desktop_cube}
+DURATION=${1:-5}
+[ $# -gt 0 ] && shift
+
+# Measure rendering cost, not the refresh rate
+export vblank_mode=0
+
+for outputs in 1 2 3 4 5 6; do
+    for threads in "" --thread-per-output; do
+        echo "== $outputs output(s) ${threads:-single thread}"
+        "$BINARY" --bench "$DURATION" --split "$outputs" $threads "$@" | grep -E '^(screen|frames:)'
+    done
+done
@@ -0,0 +1,64 @@
+#!/bin/sh
+# Run the standard benchmark scenes and collect their JSON reports, one
+# line per scene and renderer, tagged with the scene name. If a baseline
+# exists, the results are compared against it (see bench_compare.sh).
+#
+# Usage: tools/bench_suite.sh [SECONDS] [extra desktop_cube options]
+#
+# RESULTS (default build/bench-suite.jsonl) receives the results, BASELINE
+# (default bench-baseline.jsonl) is the file to compare against, empty for
+# no comparison.
+
+BINARY=${BINARY:-./build/desktop_cube}
+RESULTS=${RESULTS:-build/bench-suite.jsonl}
+BASELINE=${BASELINE-bench-baseline.jsonl}
+DURATION=${1:-10}
+[ $# -gt 0 ] && shift
+
+# Scenes: name, then desktop_cube options
+SCENES='
+single
+display-lists       --display-lists
+shaders             --shaders
+cubes-1k            --shaders --cubes 1000
+cubes-100k          --shaders --cubes 100000
+many-outputs        --split 8
+many-outputs-thread --split 8 --thread-per-output
+instrumented        --instrument --perf-counters
+'
+
+# Measure rendering cost, not the refresh rate, with the default settings
+export vblank_mode=0
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+trap 'exit 130' INT
+trap 'exit 143' TERM
+mkdir -p "$WORK/config"
+export XDG_CONFIG_HOME="$WORK/config"
+
+mkdir -p "$(dirname "$RESULTS")"
+: >"$RESULTS"
+status=0
+while read -r scene options; do
+    [ -n "$scene" ] || continue
+    echo "== $scene" >&2
+    # shellcheck disable=SC2086
+    if ! "$BINARY" --bench "$DURATION" --json $options "$@" </dev/null >"$WORK/scene.jsonl"; then
+        echo "$scene: benchmark failed" >&2
+        status=1
+        continue
+    fi
+    sed "s/^{/{\"scene\":\"$scene\",/" "$WORK/scene.jsonl" >>"$RESULTS"
+done <<EOF
+$SCENES
+EOF
+echo "Results written to $RESULTS" >&2
+
+if [ -z "$BASELINE" ]; then
+    :
+elif [ -f "$BASELINE" ]; then
+    "$(dirname "$0")/bench_compare.sh" "$BASELINE" "$RESULTS" || status=1
+else
+    echo "No baseline at $BASELINE; save one with: cp $RESULTS $BASELINE" >&2
+fi
+exit $status
@@ -0,0 +1,83 @@
+/**
+ * desktop_cube-ctl: send a command to a running desktop_cube.
+ *
+ * Usage: desktop_cube-ctl COMMAND [ARGUMENT]
+ *
+ * Prints the result of a successful command, or the error, and exits with
+ * status 0 if the reply was "ok".
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../src/control.h"
+
+// Function to print command line usage
+static void usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s COMMAND [ARGUMENT]\n"
+            "  pause | resume                stop or restart rendering\n"
+            "  fps N|default                 set the target frame rate\n"
+            "  quality low|medium|high|default\n"
+            "                                set the multisampling tier\n"
+            "  stats                         print frames, missed frames, pauses and frame\n"
+            "                                time per renderer (full statistics go to\n"
+            "                                desktop_cube's stderr)\n"
+            "  trace [SECONDS]               record a per-frame trace (default 5s)\n",
+            program);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2 || argc > 3 || strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0) {
+        usage(argv[0]);
+        exit(argc == 2 ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    char path[108];
+    if (control_socket_path(path, sizeof(path)) != 0) {
+        fprintf(stderr, "Control socket path too long\n");
+        exit(EXIT_FAILURE);
+    }
+    int fd = control_connect(path);
+    if (fd < 0) {
+        fprintf(stderr, "Cannot connect to %s, is desktop_cube running?\n", path);
+        exit(EXIT_FAILURE);
+    }
+
+    char command[CONTROL_LINE_MAX];
+    int length = snprintf(command, sizeof(command), "%s%s%s\n", argv[1], argc == 3 ? " " : "",
+                          argc == 3 ? argv[2] : "");
+    if (length < 0 || (size_t)length >= sizeof(command) || write(fd, command, length) != length) {
+        fprintf(stderr, "Failed to send command\n");
+        close(fd);
+        exit(EXIT_FAILURE);
+    }
+
+    // Read the one-line reply
+    char reply[CONTROL_REPLY_MAX];
+    size_t received = 0;
+    while (received < sizeof(reply) - 1 && !memchr(reply, '\n', received)) {
+        ssize_t count = read(fd, reply + received, sizeof(reply) - 1 - received);
+        if (count <= 0) {
+            break;
+        }
+        received += count;
+    }
+    close(fd);
+    reply[received] = '\0';
+    char *newline = strchr(reply, '\n');
+    if (newline) {
+        *newline = '\0';
+    }
+    if (strcmp(reply, "ok") == 0) {
+        exit(EXIT_SUCCESS);
+    }
+    if (strncmp(reply, "ok ", 3) == 0) {
+        printf("%s\n", reply + 3);
+        exit(EXIT_SUCCESS);
+    }
+    fprintf(stderr, "%s\n", received ? reply : "No reply");
+    exit(EXIT_FAILURE);
+}
@@ -0,0 +1,394 @@
+/**
+ * gl_replay: replay a recorded GL command stream as fast as possible.
+ *
+ * Usage: gl_replay [-n REPETITIONS] [-f] [-c CPU] RECORDING
+ *
+ * Recordings come from desktop_cube --record. The setup section (buffers,
+ * display lists, state) is replayed once, then the recorded frames are
+ * replayed back to back, REPETITIONS times, into an offscreen framebuffer
+ * of the recorded size in a surfaceless EGL context. No display is needed,
+ * and there is no swap or vsync, so the report is the CPU cost of
+ * submitting the frames: driver overhead, comparable across drivers and
+ * versions. With -f every frame is finished (glFinish) instead of flushed,
+ * which adds the GPU time.
+ *
+ * Objects created during the recorded frames (display lists recompiled
+ * after a layout or config change) are only created in the first, uncounted
+ * pass; later passes use them as they were left, so they neither leak nor
+ * time compilation as frame work.
+ */
+
+#define _GNU_SOURCE
+#define GL_GLEXT_PROTOTYPES
+
+#include <errno.h>
+#include <limits.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#include "../src/frame_stats.h"
+#include "../src/gl_record.h"
+#include "../src/scheduler.h"
+
+// Recorded buffer and display list names must be below this
+#define MAX_NAMES 4096
+
+typedef struct {
+    unsigned char *data;
+    size_t size;
+    RecordHeader header;
+    size_t setup_end;       // Offset of the first frame
+    size_t end;             // Offset after the last complete frame
+    GLuint buffers[MAX_NAMES];  // Recorded name to replayed name
+    GLuint lists[MAX_NAMES];
+} Replay;
+
+// Function to load a recording and find its sections. Returns -1 if it is
+// not a recording or has no complete frame.
+static int load_recording(Replay *replay, const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        return -1;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    replay->data = size > 0 ? malloc(size) : NULL;
+    if (!replay->data || fread(replay->data, 1, size, file) != (size_t)size) {
+        fprintf(stderr, "Failed to read %s\n", path);
+        fclose(file);
+        return -1;
+    }
+    fclose(file);
+    replay->size = size;
+
+    if (replay->size < sizeof(RecordHeader)) {
+        fprintf(stderr, "%s: not a recording\n", path);
+        return -1;
+    }
+    memcpy(&replay->header, replay->data, sizeof(RecordHeader));
+    if (memcmp(replay->header.magic, RECORD_MAGIC, sizeof(RECORD_MAGIC)) != 0 ||
+        replay->header.version != RECORD_VERSION) {
+        fprintf(stderr, "%s: not a recording, or of another version\n", path);
+        return -1;
+    }
+
+    // Walk the records once, so a truncated file fails here and not halfway
+    // through a measurement
+    size_t offset = sizeof(RecordHeader);
+    unsigned long frames = 0;
+    while (offset + sizeof(RecordCall) <= replay->size) {
+        RecordCall call;
+        memcpy(&call, replay->data + offset, sizeof(call));
+        size_t length = sizeof(call) + call.words * 4 + (call.payload + 3) / 4 * 4;
+        if (call.op == 0 || call.op >= RECORD_OPS || offset + length > replay->size) {
+            break;
+        }
+        offset += length;
+        if (call.op == RECORD_SETUP_END) {
+            replay->setup_end = offset;
+        } else if (call.op == RECORD_FRAME) {
+            replay->end = offset;
+            frames++;
+        }
+    }
+    if (!replay->setup_end || !frames || !replay->header.width || !replay->header.height) {
+        fprintf(stderr, "%s: no complete frame recorded\n", path);
+        return -1;
+    }
+    replay->header.frames = frames;
+    return 0;
+}
+
+// Function to map a recorded object name, checking its range
+static GLuint *mapped_name(GLuint *names, uint32_t name) {
+    static GLuint invalid;
+    if (name >= MAX_NAMES) {
+        fprintf(stderr, "Recorded name %u out of range\n", name);
+        return &invalid;
+    }
+    return &names[name];
+}
+
+// Function to check whether a call creates, fills or deletes an object
+// rather than drawing with it
+static int is_object_call(uint32_t op) {
+    return op == RECORD_GEN_BUFFER || op == RECORD_BUFFER_DATA || op == RECORD_GEN_LISTS ||
+           op == RECORD_DELETE_LISTS;
+}
+
+// Function to issue the calls from `offset` up to the end of the section:
+// the setup end marker or a frame end. Without `create`, object calls and
+// display list compilation are skipped. Returns the offset after it.
+static size_t replay_calls(Replay *replay, size_t offset, int create) {
+    int compiling = 0;
+    for (;;) {
+        RecordCall call;
+        memcpy(&call, replay->data + offset, sizeof(call));
+        const uint32_t *w = (const uint32_t *)(replay->data + offset + sizeof(call));
+        const float *f = (const float *)w;
+        const void *payload = call.payload ? w + call.words : NULL;
+        offset += sizeof(call) + call.words * 4 + (call.payload + 3) / 4 * 4;
+
+        if (!create && call.op != RECORD_SETUP_END && call.op != RECORD_FRAME) {
+            compiling |= call.op == RECORD_NEW_LIST;
+            if (compiling || is_object_call(call.op)) {
+                compiling &= call.op != RECORD_END_LIST;
+                continue;
+            }
+        }
+
+        switch (call.op) {
+        case RECORD_SETUP_END:
+        case RECORD_FRAME:
+            return offset;
+        case RECORD_CLEAR:
+            glClear(w[0]);
+            break;
+        case RECORD_CLEAR_COLOR:
+            glClearColor(f[0], f[1], f[2], f[3]);
+            break;
+        case RECORD_ENABLE:
+            glEnable(w[0]);
+            break;
+        case RECORD_DISABLE:
+            glDisable(w[0]);
+            break;
+        case RECORD_ENABLE_CLIENT_STATE:
+            glEnableClientState(w[0]);
+            break;
+        case RECORD_VIEWPORT:
+            glViewport(w[0], w[1], w[2], w[3]);
+            break;
+        case RECORD_SCISSOR:
+            glScissor(w[0], w[1], w[2], w[3]);
+            break;
+        case RECORD_MATRIX_MODE:
+            glMatrixMode(w[0]);
+            break;
+        case RECORD_LOAD_MATRIX:
+            glLoadMatrixf(f);
+            break;
+        case RECORD_ROTATE:
+            glRotatef(f[0], f[1], f[2], f[3]);
+            break;
+        case RECORD_GEN_BUFFER:
+            glGenBuffers(1, mapped_name(replay->buffers, w[0]));
+            break;
+        case RECORD_BIND_BUFFER:
+            glBindBuffer(w[0], w[1] ? *mapped_name(replay->buffers, w[1]) : 0);
+            break;
+        case RECORD_BUFFER_DATA:
+            glBufferData(w[0], call.payload, payload, w[1]);
+            break;
+        case RECORD_BUFFER_SUB_DATA:
+            glBufferSubData(w[0], w[1], call.payload, payload);
+            break;
+        // Client arrays point into the loaded recording, which outlives them
+        case RECORD_VERTEX_POINTER:
+            glVertexPointer(w[0], w[1], w[2], payload ? payload : (const void *)(uintptr_t)w[3]);
+            break;
+        case RECORD_COLOR_POINTER:
+            glColorPointer(w[0], w[1], w[2], payload ? payload : (const void *)(uintptr_t)w[3]);
+            break;
+        case RECORD_DRAW_ELEMENTS:
+            glDrawElements(w[0], w[1], w[2], payload ? payload : (const void *)(uintptr_t)w[3]);
+            break;
+        case RECORD_GEN_LISTS: {
+            GLuint first = glGenLists(w[1]);
+            for (uint32_t i = 0; i < w[1]; i++) {
+                *mapped_name(replay->lists, w[0] + i) = first + i;
+            }
+            break;
+        }
+        case RECORD_DELETE_LISTS:
+            glDeleteLists(*mapped_name(replay->lists, w[0]), w[1]);
+            break;
+        case RECORD_NEW_LIST:
+            glNewList(*mapped_name(replay->lists, w[0]), GL_COMPILE);
+            break;
+        case RECORD_END_LIST:
+            glEndList();
+            break;
+        case RECORD_CALL_LIST:
+            glCallList(*mapped_name(replay->lists, w[0]));
+            break;
+        }
+    }
+}
+
+// Function to create a surfaceless GL context with an offscreen framebuffer
+// of the given size. Returns -1 if there is no EGL implementation for it.
+static int create_context(int width, int height) {
+    EGLDisplay display = EGL_NO_DISPLAY;
+    const char *client_extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (client_extensions && strstr(client_extensions, "EGL_MESA_platform_surfaceless")) {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (get_platform_display) {
+            display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        }
+    }
+    if (display == EGL_NO_DISPLAY) {
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL)) {
+        fprintf(stderr, "Failed to initialize EGL\n");
+        return -1;
+    }
+
+    // The recording uses the fixed-function pipeline, so the context must
+    // be desktop GL with the compatibility profile (EGL's default). No
+    // surface is ever created, so any surface type will do.
+    static const EGLint config_attributes[] = {
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_SURFACE_TYPE, 0,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint num_configs;
+    if (!eglBindAPI(EGL_OPENGL_API) ||
+        !eglChooseConfig(display, config_attributes, &config, 1, &num_configs) || num_configs < 1) {
+        fprintf(stderr, "No EGL config for desktop OpenGL\n");
+        return -1;
+    }
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, NULL);
+    if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        fprintf(stderr, "Failed to create a surfaceless GL context\n");
+        return -1;
+    }
+
+    GLuint framebuffer, color, depth;
+    glGenRenderbuffers(1, &color);
+    glBindRenderbuffer(GL_RENDERBUFFER, color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenRenderbuffers(1, &depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "Failed to create a %dx%d framebuffer\n", width, height);
+        return -1;
+    }
+    return 0;
+}
+
+// Function to print command line usage
+static void usage(const char *program) {
+    fprintf(stderr, "Usage: %s [-n REPETITIONS] [-f] [-c CPU] RECORDING\n", program);
+}
+
+// Function to parse a whole option argument as an integer in the given
+// range. Returns -1 with a message if it is not one.
+static int parse_option(int option, const char *text, int minimum, int maximum, int *value) {
+    char *end;
+    errno = 0;
+    long number = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || errno == ERANGE || number < minimum || number > maximum) {
+        fprintf(stderr, "Invalid -%c value '%s', must be %d to %d\n", option, text, minimum, maximum);
+        return -1;
+    }
+    *value = (int)number;
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int repetitions = 10;
+    int finish = 0;
+    int cpu = -1;
+    int option;
+    while ((option = getopt(argc, argv, "n:fc:h")) != -1) {
+        switch (option) {
+        case 'n':
+            if (parse_option(option, optarg, 1, INT_MAX, &repetitions) != 0) exit(EXIT_FAILURE);
+            break;
+        case 'f':
+            finish = 1;
+            break;
+        case 'c':
+            if (parse_option(option, optarg, 0, CPU_SETSIZE - 1, &cpu) != 0) exit(EXIT_FAILURE);
+            break;
+        default:
+            usage(argv[0]);
+            exit(option == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+    if (optind != argc - 1) {
+        usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+            perror("sched_setaffinity");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    static Replay replay;
+    if (load_recording(&replay, argv[optind]) != 0 ||
+        create_context(replay.header.width, replay.header.height) != 0) {
+        exit(EXIT_FAILURE);
+    }
+    printf("recording: %u frames at %ux%u, %.1f KiB\n", replay.header.frames, replay.header.width,
+           replay.header.height, replay.size / 1024.0);
+    printf("renderer: %s\n", (const char *)glGetString(GL_RENDERER));
+
+    replay_calls(&replay, sizeof(RecordHeader), 1);
+    glFinish();
+
+    // The first repetition warms up caches and the driver's lazy state
+    // validation, and creates the objects of the frames. It is not counted.
+    static SampleSeries cpu_time, wall_time;
+    double cpu_total = 0.0;
+    double wall_total = 0.0;
+    unsigned long frames = 0;
+    for (int repetition = 0; repetition <= repetitions; repetition++) {
+        for (size_t offset = replay.setup_end; offset < replay.end;) {
+            double cpu_start = clock_seconds(CLOCK_THREAD_CPUTIME_ID);
+            double wall_start = clock_seconds(CLOCK_MONOTONIC);
+            offset = replay_calls(&replay, offset, repetition == 0);
+            if (finish) {
+                glFinish();
+            } else {
+                glFlush();
+            }
+            double cpu_elapsed = clock_seconds(CLOCK_THREAD_CPUTIME_ID) - cpu_start;
+            double wall_elapsed = clock_seconds(CLOCK_MONOTONIC) - wall_start;
+            if (repetition > 0) {
+                series_add(&cpu_time, cpu_elapsed * 1000.0);
+                series_add(&wall_time, wall_elapsed * 1000.0);
+                cpu_total += cpu_elapsed;
+                wall_total += wall_elapsed;
+                frames++;
+            }
+        }
+    }
+    glFinish();
+
+    GLenum error = glGetError();
+    if (error != GL_NO_ERROR) {
+        fprintf(stderr, "GL error 0x%04x during replay\n", error);
+    }
+    printf("frames: %lu, %.0f FPS\n", frames, frames / wall_total);
+    series_print(stdout, "frame cpu", &cpu_time);
+    series_print(stdout, "frame wall", &wall_time);
+    printf("cpu per frame: %.3f ms\n", cpu_total * 1000.0 / frames);
+    return error == GL_NO_ERROR ? EXIT_SUCCESS : EXIT_FAILURE;
+}
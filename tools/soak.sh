@@ -0,0 +1,59 @@
+#!/bin/sh
+# Soak test without a display: run desktop_cube unpaced for hours in its own
+# Xvfb server with --soak, which samples memory, file descriptors, GL
+# objects, queued X events and frame times, changes the monitor layout after
+# every sample and recreates the window and context after every fifth, and
+# fails if any metric grows over the run.
+#
+# Usage: tools/soak.sh [HOURS] [extra desktop_cube options]
+#
+# INTERVAL sets the seconds between samples (default 60). The samples and
+# the trend report go to stdout and to LOG (default build/soak.log). Exits
+# with desktop_cube's status. Needs Xvfb and xdpyinfo.
+
+BINARY=${BINARY:-./build/desktop_cube}
+LOG=${LOG:-build/soak.log}
+INTERVAL=${INTERVAL:-60}
+HOURS=${1:-4}
+[ $# -gt 0 ] && shift
+DISPLAY_NUMBER=${DISPLAY_NUMBER:-98}
+
+for tool in Xvfb xdpyinfo; do
+    if ! command -v "$tool" >/dev/null 2>&1; then
+        echo "$tool not found" >&2
+        exit 1
+    fi
+done
+
+# Known settings whatever the user's config file says, and rendering as
+# fast as the machine allows
+WORK=$(mktemp -d)
+trap 'kill "$XVFB" 2>/dev/null; rm -rf "$WORK"' EXIT
+trap 'exit 130' INT
+trap 'exit 143' TERM
+mkdir -p "$WORK/config" "$WORK/runtime"
+chmod 700 "$WORK/runtime"
+export XDG_CONFIG_HOME="$WORK/config" XDG_RUNTIME_DIR="$WORK/runtime"
+export vblank_mode=0
+
+Xvfb ":$DISPLAY_NUMBER" -screen 0 1920x1080x24 -nolisten tcp </dev/null >/dev/null 2>&1 &
+XVFB=$!
+export DISPLAY=":$DISPLAY_NUMBER"
+tries=0
+until xdpyinfo >/dev/null 2>&1; do
+    tries=$((tries + 1))
+    if [ "$tries" -gt 50 ]; then
+        echo "Xvfb did not start" >&2
+        exit 1
+    fi
+    sleep 0.1
+done
+
+mkdir -p "$(dirname "$LOG")"
+seconds=$(awk "BEGIN { print $HOURS * 3600 }")
+# The exit status of desktop_cube, not tee's, is the result
+{
+    "$BINARY" --soak "$seconds" --soak-interval "$INTERVAL" "$@" </dev/null
+    echo $? >"$WORK/status"
+} | tee "$LOG"
+exit "$(cat "$WORK/status")"